@@ -0,0 +1,459 @@
+#ifndef CONCURRENT_HEAPARRAY_H
+#define CONCURRENT_HEAPARRAY_H
+/**
+ * @file concurrent_heaparray.h
+ *
+ * Defines the ConcurrentHeapArray, a HeapArray that many threads can search
+ * and modify at once.  Each partition is its own lock domain (a reader/writer
+ * lock per partition), so threads working in different partitions never
+ * wait for each other, and lookups in the same partition share its lock.
+ *
+ *
+ * @author    Jason L Causey
+ * @license   Released under the MIT License: http://opensource.org/licenses/MIT
+ * @copyright Copyright (c) 2015 Jason L Causey, Arkansas State University
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include "heaparray.h"
+
+namespace _heaparray{
+    /*
+     * is `std::atomic<T>` always lock-free? (false, without instantiating it, for types
+     * that can't be atomic at all)
+     */
+    template <typename T, bool = std::is_trivially_copyable<T>::value && std::is_default_constructible<T>::value>
+    struct has_lock_free_atomic : std::false_type{};
+
+    template <typename T>
+    struct has_lock_free_atomic<T, true> : std::integral_constant<bool, std::atomic<T>::is_always_lock_free>{};
+}
+
+/**
+ * @brief   A HeapArray for concurrent readers and writers, locked per partition.
+ * @details Partitions are natural lock domains: a lookup only needs the one partition
+ *          a binary search over the partitions points it to, an insert "ripples"
+ *          strictly forward (towards larger partitions), and a remove pulls values
+ *          back from the partitions after the victim's, again working forward.  So each
+ *          partition has its own reader/writer lock, and every operation takes locks in
+ *          increasing partition order, holding at most two at a time (hand-over-hand),
+ *          which rules out deadlock.
+ *
+ *          Lookups are optimistic: the binary search for the partition runs without any
+ *          locks, over a copy of each partition's maximum (kept in a lock-free
+ *          `std::atomic` when `DataType` allows it, otherwise read under the partition's
+ *          shared lock).  The chosen partition is then locked for reading, and if the value
+ *          lies between its minimum and maximum the answer is final; otherwise the search
+ *          steps to the neighbouring partition, taking its lock in order.  Lookups of
+ *          values in different partitions proceed fully in parallel, and lookups in the
+ *          same partition share its lock.
+ *
+ *          The capacity is fixed at construction (storage can't move while other threads
+ *          hold pointers into it).  Values come back from `min()` and `max()` by copy,
+ *          since a reference could be invalidated by another thread at any moment.
+ *
+ * @tparam  DataType    the type of data stored - same requirements as the `DataType`
+ *                      of a HeapArray
+ * @tparam  Compare     the type of the function object that orders the values
+ *                      (`std::less<DataType>` by default)
+ * @tparam  Equal       the type of the function object used to match values in
+ *                      searches (`std::equal_to<DataType>` by default)
+ */
+template <typename DataType, typename Compare = std::less<DataType>, typename Equal = std::equal_to<DataType>>
+class ConcurrentHeapArray{
+public:
+    explicit ConcurrentHeapArray(size_t capacity, const Compare& compare = Compare(), const Equal& equality = Equal());
+    ConcurrentHeapArray(const ConcurrentHeapArray&) = delete;
+    ConcurrentHeapArray& operator=(const ConcurrentHeapArray&) = delete;
+
+    void                    insert(const DataType& value);
+    void                    insert(DataType&& value);
+    bool                    remove(const DataType& value);
+    bool                    contains(const DataType& value)const;
+    DataType                min()const;
+    DataType                max()const;
+    size_t                  size()const;
+    size_t                  capacity()const;
+    bool                    empty()const;
+
+protected:
+    static constexpr bool atomic_bounds = _heaparray::has_lock_free_atomic<DataType>::value;
+    typedef typename std::conditional<atomic_bounds, std::atomic<DataType>, DataType>::type bound_type;
+    typedef std::shared_lock<std::shared_mutex> read_lock;
+    typedef std::unique_lock<std::shared_mutex> write_lock;
+
+    struct alignas(64) partition{                                                                   // (one per cache line)
+        mutable std::shared_mutex mutex;
+        size_t                    n  = 0;                                                           // number of values (guarded by `mutex`)
+        bound_type                hi{};                                                             // copy of the maximum, for the search
+    };
+
+    DataType*               _data(size_t p)const;
+    size_t                  _size(size_t p)const;
+    bool                    _full(size_t p)const;
+    DataType                _load_max(size_t p)const;
+    void                    _store_max(size_t p);
+    size_t                  _search(const DataType& value)const;
+    size_t                  _step(size_t p, const DataType& value)const;
+
+    Compare                       comp;                                                             // orders the values
+    Equal                         equal;                                                            // matches values in searches
+    size_t                        partitions;                                                       // number of partitions allocated
+    size_t                        storage;                                                          // partitions^2 slots
+    std::unique_ptr<DataType[]>   a;                                                                // the values
+    std::unique_ptr<partition[]>  parts;                                                            // the locks and sizes
+    std::atomic<size_t>           count{0};                                                         // values stored, or reserved by an insert
+};
+
+/**
+ * Construct an empty ConcurrentHeapArray with room for (at least) `capacity` values.
+ *
+ * @param capacity  the number of values to make room for (rounded up to a perfect square)
+ * @param compare   the comparison function object (default-constructed if not given)
+ * @param equality  the equality function object (default-constructed if not given)
+ */
+template <typename DataType, typename Compare, typename Equal>
+ConcurrentHeapArray<DataType, Compare, Equal>::ConcurrentHeapArray(size_t capacity, const Compare& compare, const Equal& equality)
+    : comp(compare), equal(equality){
+    partitions = capacity > 0 ? _heaparray::isqrt(capacity - 1) + 1 : 1;
+    storage    = partitions * partitions;
+    a.reset(new DataType[storage]);
+    parts.reset(new partition[partitions]);
+}
+
+/**
+ * @brief   Insert a new item into the ConcurrentHeapArray.
+ * @details Finds the partition `value` belongs in as a lookup does, then locks it (and
+ *          its predecessor, to confirm the choice) and ripples the displaced maximum
+ *          forward hand-over-hand, holding each partition until the next one is locked.
+ *          Inserts into different parts of the structure run concurrently until their
+ *          ripples meet.
+ *
+ * @param  value  the value to insert
+ * @throws std::length_error  if the ConcurrentHeapArray is full
+ */
+template <typename DataType, typename Compare, typename Equal>
+void ConcurrentHeapArray<DataType, Compare, Equal>::insert(const DataType& value){
+    insert(DataType(value));
+}
+
+/**
+ * Insert a new item into the ConcurrentHeapArray, by move
+ * (see `insert(const DataType&)`).
+ *
+ * @param  value  the value to insert
+ * @throws std::length_error  if the ConcurrentHeapArray is full
+ */
+template <typename DataType, typename Compare, typename Equal>
+void ConcurrentHeapArray<DataType, Compare, Equal>::insert(DataType&& value){
+    size_t reserved = count.load();                                                                 // claim a slot first, so the ripple is
+    do{                                                                                             // sure to find room at the end
+        if(reserved >= storage){
+            throw std::length_error("Maximum size exceeded for fixed-size container.");
+        }
+    }while(!count.compare_exchange_weak(reserved, reserved + 1));
+    size_t     p = _search(value);
+    write_lock here;
+    for(;;){                                                                                        // lock the partition and confirm that it
+        read_lock below;                                                                            // is the right one: its predecessor is full
+        if(p > 0){                                                                                  // and not above `value`, and it has room
+            below = read_lock(parts[p - 1].mutex);                                                  // or is not below `value`
+        }
+        here = write_lock(parts[p].mutex);
+        bool low_ok  = p == 0 || (_full(p - 1) && !comp(value, heap_max(_data(p - 1), parts[p - 1].n, comp)));
+        bool high_ok = !_full(p) || !comp(heap_max(_data(p), parts[p].n, comp), value);
+        if(low_ok && high_ok){
+            break;
+        }
+        p = low_ok ? p + 1 : p - 1;                                                                 // (stale search: step towards the value)
+        here.unlock();
+    }
+    for(;;){                                                                                        // then ripple forward, hand-over-hand
+        auto ripple = heap_insert_circular(std::move(value), _data(p), parts[p].n, _size(p), comp);
+        _store_max(p);
+        if(!ripple.first){
+            return;
+        }
+        value = std::move(ripple.second);
+        write_lock next(parts[p + 1].mutex);                                                        // (the reserved slot guarantees p+1 exists)
+        here.swap(next);                                                                            // `next` now holds (and releases) `p`
+        ++p;
+    }
+}
+
+/**
+ * @brief   Remove an element from the ConcurrentHeapArray, given its value.
+ * @details Finds and locks the partition holding `value`, removes it, and refills the
+ *          partition from the minimum of the next one, working forward hand-over-hand to
+ *          the end of the structure.
+ *
+ * @param  value  the value to remove
+ * @return `true` if `value` was found and removed, `false` otherwise
+ */
+template <typename DataType, typename Compare, typename Equal>
+bool ConcurrentHeapArray<DataType, Compare, Equal>::remove(const DataType& value){
+    size_t     p = _search(value);
+    write_lock here;
+    for(;;){
+        read_lock below;
+        if(p > 0){
+            below = read_lock(parts[p - 1].mutex);
+        }
+        here = write_lock(parts[p].mutex);
+        auto next_p = _step(p, value);
+        if(next_p == p){
+            break;
+        }
+        p = next_p;
+        here.unlock();
+    }
+    auto i = _heaparray::find_equal(_data(p), parts[p].n, value, equal);
+    if(i == parts[p].n){
+        return false;
+    }
+    heap_remove_at_index(i, _data(p), parts[p].n, comp);                                            // leaves partition `p` one short,
+    _store_max(p);
+    while(p + 1 < partitions){                                                                      // so refill it from the next partition,
+        write_lock next(parts[p + 1].mutex);                                                        // which is then one short in turn (until
+        if(parts[p + 1].n == 0){                                                                    // the end of the values)
+            break;
+        }
+        heap_insert(heap_remove_min(_data(p + 1), parts[p + 1].n, comp), _data(p), parts[p].n, _size(p), comp);
+        _store_max(p);
+        _store_max(p + 1);
+        here.swap(next);                                                                            // `next` now holds (and releases) `p`
+        ++p;
+    }
+    count.fetch_sub(1);
+    return true;
+}
+
+/**
+ * @brief   Search for a value.
+ * @details Runs the partition search without locks, then locks only the partition it
+ *          chose, for reading.  If `value` lies between that partition's minimum and
+ *          maximum, the partition holds it or nothing does; otherwise the search
+ *          steps to the neighbouring partition (locking its predecessor too, in order).
+ *
+ * @param  value  the value to search for
+ * @return `true` if `value` is present
+ */
+template <typename DataType, typename Compare, typename Equal>
+bool ConcurrentHeapArray<DataType, Compare, Equal>::contains(const DataType& value)const{
+    size_t p = _search(value);
+    {
+        read_lock here(parts[p].mutex);                                                             // the fast path: one shared lock
+        auto n = parts[p].n;
+        if(n > 0 && !comp(value, heap_min(_data(p), n, comp)) && !comp(heap_max(_data(p), n, comp), value)){
+            return _heaparray::find_equal(_data(p), n, value, equal) < n;
+        }
+    }
+    for(;;){
+        read_lock below;
+        if(p > 0){
+            below = read_lock(parts[p - 1].mutex);
+        }
+        read_lock here(parts[p].mutex);
+        auto next_p = _step(p, value);
+        if(next_p == p){
+            return _heaparray::find_equal(_data(p), parts[p].n, value, equal) < parts[p].n;
+        }
+        p = next_p;
+    }
+}
+
+/**
+ * Get (a copy of) the minimum value in the ConcurrentHeapArray.
+ * @return the minimum value
+ * @throws std::out_of_range if the ConcurrentHeapArray is empty
+ */
+template <typename DataType, typename Compare, typename Equal>
+DataType ConcurrentHeapArray<DataType, Compare, Equal>::min()const{
+    read_lock first(parts[0].mutex);
+    if(parts[0].n == 0){
+        throw std::out_of_range("ConcurrentHeapArray is empty.");
+    }
+    return _data(0)[0];
+}
+
+/**
+ * Get (a copy of) the maximum value in the ConcurrentHeapArray (the maximum of the
+ * final non-empty partition, which is confirmed by locking it and its successor).
+ * @return the maximum value
+ * @throws std::out_of_range if the ConcurrentHeapArray is empty
+ */
+template <typename DataType, typename Compare, typename Equal>
+DataType ConcurrentHeapArray<DataType, Compare, Equal>::max()const{
+    auto c = count.load();
+    auto p = std::min(c > 0 ? _heaparray::isqrt(c - 1) : 0, partitions - 1);
+    for(;;){
+        read_lock here(parts[p].mutex);
+        read_lock after;
+        if(p + 1 < partitions){
+            after = read_lock(parts[p + 1].mutex);
+        }
+        if(parts[p].n == 0 && p == 0){
+            throw std::out_of_range("ConcurrentHeapArray is empty.");
+        }
+        if(parts[p].n == 0){
+            --p;
+        }
+        else if(p + 1 < partitions && parts[p + 1].n > 0){
+            ++p;
+        }
+        else{
+            return heap_max(_data(p), parts[p].n, comp);
+        }
+    }
+}
+
+/**
+ * Get the number of values in the ConcurrentHeapArray (including any inserts that
+ * are still in progress).
+ * @return the number of values
+ */
+template <typename DataType, typename Compare, typename Equal>
+inline size_t ConcurrentHeapArray<DataType, Compare, Equal>::size()const{
+    return count.load(std::memory_order_relaxed);
+}
+
+/**
+ * Get the number of values the ConcurrentHeapArray has room for.
+ * @return the capacity
+ */
+template <typename DataType, typename Compare, typename Equal>
+inline size_t ConcurrentHeapArray<DataType, Compare, Equal>::capacity()const{
+    return storage;
+}
+
+/**
+ * Is the ConcurrentHeapArray empty?
+ * @return `true` if it holds no values
+ */
+template <typename DataType, typename Compare, typename Equal>
+inline bool ConcurrentHeapArray<DataType, Compare, Equal>::empty()const{
+    return size() == 0;
+}
+
+/*
+ * Get the address of the first slot of partition `p`.
+ */
+template <typename DataType, typename Compare, typename Equal>
+inline DataType* ConcurrentHeapArray<DataType, Compare, Equal>::_data(size_t p)const{
+    return a.get() + p * p;
+}
+
+/*
+ * Get the size (number of slots) of partition `p`.
+ */
+template <typename DataType, typename Compare, typename Equal>
+inline size_t ConcurrentHeapArray<DataType, Compare, Equal>::_size(size_t p)const{
+    return p * 2 + 1;
+}
+
+/*
+ * Is partition `p` full?  (The caller must hold its lock.)
+ */
+template <typename DataType, typename Compare, typename Equal>
+inline bool ConcurrentHeapArray<DataType, Compare, Equal>::_full(size_t p)const{
+    return parts[p].n == _size(p);
+}
+
+/*
+ * Reads the copy of partition `p`'s maximum kept for the search (with a lock-free
+ * atomic load if possible, otherwise under the partition's shared lock).  The caller
+ * must not hold the partition's lock.
+ */
+template <typename DataType, typename Compare, typename Equal>
+inline DataType ConcurrentHeapArray<DataType, Compare, Equal>::_load_max(size_t p)const{
+    if constexpr(atomic_bounds){
+        return parts[p].hi.load(std::memory_order_relaxed);                                         // (only a hint; it's checked under the lock)
+    }
+    else{
+        read_lock lock(parts[p].mutex);
+        return parts[p].hi;
+    }
+}
+
+/*
+ * Refreshes the copy of partition `p`'s maximum (the caller holds its write lock).
+ */
+template <typename DataType, typename Compare, typename Equal>
+inline void ConcurrentHeapArray<DataType, Compare, Equal>::_store_max(size_t p){
+    if(parts[p].n > 0){
+        if constexpr(atomic_bounds){
+            parts[p].hi.store(heap_max(_data(p), parts[p].n, comp), std::memory_order_relaxed);
+        }
+        else{
+            parts[p].hi = heap_max(_data(p), parts[p].n, comp);
+        }
+    }
+}
+
+/*
+ * Guesses which partition `value` belongs in, without taking any locks: a binary
+ * search for the first partition whose (copied) maximum is not less than `value`,
+ * among the partitions the current count says are in use.  The answer is only a
+ * starting point; the caller confirms it under the partition's lock.
+ */
+template <typename DataType, typename Compare, typename Equal>
+size_t ConcurrentHeapArray<DataType, Compare, Equal>::_search(const DataType& value)const{
+    auto   c     = count.load(std::memory_order_relaxed);
+    size_t left  = 0;
+    size_t right = std::min(c > 0 ? _heaparray::isqrt(c - 1) : 0, partitions - 1);
+    while(left < right){
+        auto mid = left + (right - left) / 2;
+        if(comp(_load_max(mid), value)){
+            left = mid + 1;
+        }
+        else{
+            right = mid;
+        }
+    }
+    return left;
+}
+
+/*
+ * Decides, with partition `p` (and `p - 1`, if there is one) locked, whether `p` is
+ * the only partition that could hold `value`, and returns `p` if so, or otherwise the
+ * neighbouring partition to look in next: the one before if `p - 1` is not full or
+ * could hold `value` itself, or the one after if `p` is full and its maximum is below
+ * `value`.
+ */
+template <typename DataType, typename Compare, typename Equal>
+size_t ConcurrentHeapArray<DataType, Compare, Equal>::_step(size_t p, const DataType& value)const{
+    if(p > 0 && (!_full(p - 1) || !comp(heap_max(_data(p - 1), parts[p - 1].n, comp), value))){
+        return p - 1;
+    }
+    if(p + 1 < partitions && _full(p) && comp(heap_max(_data(p), parts[p].n, comp), value)){
+        return p + 1;
+    }
+    return p;
+}
+
+#endif
@@ -32,13 +32,657 @@
  */
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <numeric>
 #include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
 #include <tuple>
+#include <type_traits>
+#include <vector>
 #include <cmath>
+#if __has_include(<memory_resource>)
+    #include <memory_resource>
+#endif
+#if __has_include(<execution>) && defined(HEAPARRAY_EXECUTION)
+    #include <execution>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define HEAPARRAY_HAS_MMAP 1
+#endif
 #include "mmheap.h"
+#include "partition_scan.h"
     using namespace mmheap;
 
+namespace _heaparray{
+    /**
+     * exact integer square root (the largest `r` such that `r*r <= n`), computed
+     * without floating point (and so without rounding trouble past 2^53)
+     *
+     * @param  n value to compute the square root of
+     * @return floor(sqrt(n))
+     */
+    inline size_t isqrt(size_t n){
+        if(n < 2){
+            return n;
+        }
+        size_t x = size_t{1} << (_mmheap::log_2(n) / 2 + 1);                                        // a power of two above sqrt(n), from which
+        size_t y = (x + n / x) / 2;                                                                 // Newton's method decreases monotonically
+        while(y < x){                                                                               // onto the floor of the root
+            x = y;
+            y = (x + n / x) / 2;
+        }
+        return x;
+    }
+
+    /*
+     * hint that the cache line holding `address` will be read soon (a no-op on
+     * compilers without a prefetch builtin)
+     */
+    inline void prefetch(const void* address){
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address, 0, 3);
+#else
+        (void)address;
+#endif
+    }
+
+    /**
+     * Indicates whether `std::hash<DataType>` is enabled (so a membership filter can
+     * be kept for `DataType`).
+     */
+    template <typename DataType, typename = void>
+    struct is_hashable : std::false_type{};
+    template <typename DataType>
+    struct is_hashable<DataType, decltype(void(std::hash<DataType>{}(std::declval<const DataType&>())))> : std::true_type{};
+
+    /*
+     * spread the bits of a hash (`std::hash` is the identity for integers) over all
+     * 64 bits (the MurmurHash3 finalizer)
+     */
+    inline uint64_t mix_hash(uint64_t h){
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /**
+     * @brief   counting Bloom filter over (mixed) 64-bit hashes, blocked by cache line
+     * @details Each value increments HASHES 4-bit counters, all within one 64-byte block
+     *          (of 128 counters) chosen by its hash, so a lookup reads a single cache line.
+     *          Removing a value decrements its counters again, so the filter follows the
+     *          set through inserts and removes.  A counter that reaches 15 saturates and is
+     *          never decremented after that, so removals never cause false negatives (only,
+     *          rarely, a stale positive).  With COUNTERS_PER_VALUE counters per value, about
+     *          3% of absent values pass the filter.
+     */
+    class counting_filter{
+    public:
+        static const size_t HASHES             = 4;
+        static const size_t COUNTERS_PER_VALUE = 8;
+
+        /*
+         * clear the filter and size it for `values` values
+         */
+        void reset(size_t values){
+            size_t blocks = 1;
+            while(blocks * BLOCK_COUNTERS < values * COUNTERS_PER_VALUE){
+                blocks *= 2;                                                                        // (a power of two, so the block is a mask)
+            }
+            cells.assign(blocks, block{});
+            mask = blocks - 1;
+        }
+
+        /*
+         * the number of values the filter is sized for
+         */
+        size_t capacity()const{
+            return cells.size() * BLOCK_COUNTERS / COUNTERS_PER_VALUE;
+        }
+
+        void add(uint64_t hash){
+            _each(hash, [](uint8_t& cell, unsigned shift){
+                if(((cell >> shift) & 15) != 15){
+                    cell += uint8_t(1u << shift);
+                }
+            });
+        }
+
+        void drop(uint64_t hash){
+            _each(hash, [](uint8_t& cell, unsigned shift){
+                auto counter = (cell >> shift) & 15;
+                if(counter != 15 && counter != 0){
+                    cell -= uint8_t(1u << shift);
+                }
+            });
+        }
+
+        /*
+         * `false` only if no value with this hash has been added (and not dropped)
+         */
+        bool maybe_contains(uint64_t hash)const{
+            auto& cell = cells[(hash >> 32) & mask].cells;
+            bool  hit  = true;
+            for(size_t h = 0; hit && h < HASHES; ++h){
+                auto counter = (hash >> (7 * h)) & (BLOCK_COUNTERS - 1);
+                hit          = ((cell[counter / 2] >> (counter % 2 * 4)) & 15) != 0;
+            }
+            return hit;
+        }
+
+        /*
+         * the address `maybe_contains(hash)` will read
+         */
+        const void* address(uint64_t hash)const{
+            return &cells[(hash >> 32) & mask];
+        }
+
+    private:
+        static const size_t BLOCK_COUNTERS = 128;
+
+        struct alignas(64) block{
+            uint8_t cells[BLOCK_COUNTERS / 2];                                                      // two 4-bit counters per byte
+        };
+
+        template <typename Function>
+        void _each(uint64_t hash, Function f){
+            auto& cell = cells[(hash >> 32) & mask].cells;
+            for(size_t h = 0; h < HASHES; ++h){
+                auto counter = (hash >> (7 * h)) & (BLOCK_COUNTERS - 1);                             // (7 bits of the hash per counter)
+                f(cell[counter / 2], unsigned(counter % 2 * 4));
+            }
+        }
+
+        std::vector<block> cells;
+        uint64_t           mask = 0;
+    };
+
+    /**
+     * @brief   random-access iterator over the slots of a segmented HeapArray
+     * @details Each partition of a segmented HeapArray is contiguous, but consecutive
+     *          partitions may live in different blocks of memory; the iterator walks a
+     *          directory holding the address of each partition.  It caches the partition
+     *          it last dereferenced, so stepping through a partition is plain pointer
+     *          arithmetic, and only moving into another one consults the directory.
+     *
+     * @tparam  DataType    the type of data stored in the HeapArray
+     * @tparam  Geometry    the HeapArray's partition geometry policy
+     */
+    template <typename DataType, typename Geometry>
+    class segmented_iterator{
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef DataType                        value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef DataType*                       pointer;
+        typedef DataType&                       reference;
+
+        segmented_iterator() = default;
+        segmented_iterator(DataType* const* partitions, size_t index) : parts(partitions), i(index){}
+
+        reference           operator*()const{
+            if(i - first >= span){                                                                  // (unsigned: also catches i < first)
+                p     = Geometry::partition_of(i);
+                first = Geometry::start(p);
+                span  = Geometry::size(p);
+            }
+            return parts[p][i - first];
+        }
+        pointer             operator->()const                          { return &**this;                          }
+        reference           operator[](difference_type n)const         { return *(*this + n);                     }
+        segmented_iterator& operator++()                               { ++i; return *this;                       }
+        segmented_iterator& operator--()                               { --i; return *this;                       }
+        segmented_iterator  operator++(int)                            { auto t = *this; ++i; return t;           }
+        segmented_iterator  operator--(int)                            { auto t = *this; --i; return t;           }
+        segmented_iterator& operator+=(difference_type n)              { i += n; return *this;                    }
+        segmented_iterator& operator-=(difference_type n)              { i -= n; return *this;                    }
+        segmented_iterator  operator+(difference_type n)const          { auto t = *this; return t += n;           }
+        segmented_iterator  operator-(difference_type n)const          { auto t = *this; return t -= n;           }
+        difference_type     operator-(const segmented_iterator& r)const{ return difference_type(i) - difference_type(r.i); }
+        bool                operator==(const segmented_iterator& r)const{ return i == r.i;                        }
+        bool                operator!=(const segmented_iterator& r)const{ return i != r.i;                        }
+        bool                operator< (const segmented_iterator& r)const{ return i <  r.i;                        }
+        bool                operator> (const segmented_iterator& r)const{ return i >  r.i;                        }
+        bool                operator<=(const segmented_iterator& r)const{ return i <= r.i;                        }
+        bool                operator>=(const segmented_iterator& r)const{ return i >= r.i;                        }
+        friend segmented_iterator operator+(difference_type n, const segmented_iterator& it){ return it + n;     }
+
+    private:
+        DataType* const* parts = nullptr;                                                           // partition directory
+        size_t           i     = 0;                                                                 // slot index
+        mutable size_t   p     = 0;                                                                 // cached partition (valid if
+        mutable size_t   first = 0;                                                                 // `i` lies within the `span`
+        mutable size_t   span  = 0;                                                                 // slots starting at `first`)
+    };
+
+    /**
+     * @brief   the header at the start of a HeapArray image file
+     * @details An image is this header followed directly by `storage` slots, the first
+     *          `count` of which hold the values in their partitioned order, so a mapping of
+     *          the file can be used in place.  Values are stored as raw bytes in the native
+     *          representation, so an image can only be read back as the same `DataType`
+     *          (checked by size only), with the same `Compare`, on a machine of the same
+     *          byte order.  The header is 64 bytes, which keeps the values aligned.
+     */
+    struct image_header{
+        char     magic[8];                                                                          // "HEAPARR" (NUL-terminated)
+        uint32_t version;                                                                           // image format version
+        uint32_t value_size;                                                                        // sizeof(DataType)
+        uint64_t count;                                                                             // number of values
+        uint64_t storage;                                                                           // number of slots in the file
+        uint64_t checksum;                                                                          // checksum of the values (0 if not recorded)
+        uint64_t geometry;                                                                          // partition layout (0: the default layout)
+        uint64_t reserved[2];
+
+        static const uint32_t VERSION = 1;
+
+        /*
+         * identifies the partition layout of a geometry policy by the sizes of its first two
+         * partitions (0 for `square_geometry`, which images written before geometries were
+         * recorded all use)
+         */
+        template <typename Geometry>
+        static uint64_t geometry_of(){
+            return Geometry::size(0) == 1 && Geometry::size(1) == 3 ? 0 : Geometry::size(0) | uint64_t(Geometry::size(1)) << 32;
+        }
+
+        /*
+         * a header for an image of `count` values of `value_size` bytes, in `storage` slots
+         * laid out in partitions by `Geometry`
+         */
+        template <typename Geometry>
+        static image_header make(size_t value_size, size_t count, size_t storage){
+            image_header header = {};
+            std::memcpy(header.magic, "HEAPARR", 8);
+            header.version    = VERSION;
+            header.value_size = static_cast<uint32_t>(value_size);
+            header.count      = count;
+            header.storage    = storage;
+            header.geometry   = geometry_of<Geometry>();
+            return header;
+        }
+
+        /*
+         * does this header describe a well-formed image of values of `value_size` bytes,
+         * laid out by `Geometry`?
+         */
+        template <typename Geometry>
+        bool valid(size_t value_size)const{
+            return std::memcmp(magic, "HEAPARR", 8) == 0 && version == VERSION && this->value_size == value_size
+                && count <= storage && geometry == geometry_of<Geometry>();
+        }
+    };
+    static_assert(sizeof(image_header) == 64, "the image header must stay 64 bytes");
+
+    const uint64_t FNV_OFFSET = 14695981039346656037ull;
+    const uint64_t FNV_PRIME  = 1099511628211ull;
+
+    /*
+     * continue a 64-bit FNV-1a hash (`hash`, starting from FNV_OFFSET) over `bytes` bytes of `data`
+     */
+    inline uint64_t fnv1a(uint64_t hash, const void* data, size_t bytes){
+        auto p = static_cast<const unsigned char*>(data);
+        for(size_t i = 0; i < bytes; ++i){
+            hash = (hash ^ p[i]) * FNV_PRIME;
+        }
+        return hash;
+    }
+
+    /*
+     * the number of threads work under the execution policy `Policy` may use
+     * (1 for the sequenced policies)
+     */
+    template <typename Policy>
+    size_t policy_threads(){
+#if defined(__cpp_lib_execution)
+        if(std::is_same<typename std::decay<Policy>::type, std::execution::sequenced_policy>::value){
+            return 1;
+        }
+    #if __cpp_lib_execution >= 201902L
+        if(std::is_same<typename std::decay<Policy>::type, std::execution::unsequenced_policy>::value){
+            return 1;
+        }
+    #endif
+#endif
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    /*
+     * runs `task(0)` ... `task(tasks - 1)` concurrently, one thread each (task 0 on the
+     * calling thread), and rethrows the first exception any of them threw once all
+     * have finished; a task whose thread can't be started runs on the calling thread
+     */
+    template <typename Task>
+    void parallel_for(size_t tasks, Task task){
+        std::vector<std::exception_ptr> errors(tasks);
+        auto run = [&](size_t t){
+            try{
+                task(t);
+            }
+            catch(...){
+                errors[t] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> workers;
+        for(size_t t = 1; t < tasks; ++t){
+            try{
+                workers.emplace_back(run, t);
+            }
+            catch(const std::system_error&){
+                run(t);
+            }
+        }
+        run(0);
+        for(auto& worker : workers){
+            worker.join();
+        }
+        for(auto& error : errors){
+            if(error){
+                std::rethrow_exception(error);
+            }
+        }
+    }
+}
+
+namespace _heaparray{
+    /*
+     * Moves each value in partitions [first_partition, last_partition) of a partitioned
+     * array holding `count` values into the right partition (each partition then holds
+     * the right set of values, in no particular order), by selection rather than
+     * sorting: `nth_element` splits the range at the partition boundary nearest its
+     * middle value, and each side is split in turn (by separate threads, if `threads` > 1).
+     * Each level of the recursion is a linear pass, leaving log2(partitions) levels
+     * instead of the log2(n) a full sort would need; ranges too small to be worth
+     * splitting are sorted.
+     *     slots       random-access iterator to the slot with index `slots_index`
+     *                 (at or before the first slot of `first_partition`)
+     */
+    template <typename Geometry, typename RandomIterator, typename Compare>
+    void select_partitions(RandomIterator slots, size_t slots_index, size_t count, size_t first_partition, size_t last_partition,
+                           Compare comp, size_t threads = 1){
+        const size_t SORT_SIZE = 64;                                                                // (below this, a sort is cheaper)
+        auto first = Geometry::start(first_partition);
+        auto last  = std::min(count, Geometry::start(last_partition));
+        if(last_partition - first_partition < 2 || last <= first){
+            return;                                                                                 // one partition: any order is fine
+        }
+        auto at = [&](size_t i){ return slots + (i - slots_index); };
+        if(last - first <= SORT_SIZE){
+            std::sort(at(first), at(last), comp);
+            return;
+        }
+        auto mid = std::min(std::max(Geometry::partition_of(first + (last - first) / 2), first_partition + 1),
+                            last_partition - 1);                                                    // (start(mid) lies past `first`)
+        std::nth_element(at(first), at(Geometry::start(mid)), at(last), comp);
+        if(threads > 1){
+            parallel_for(2, [&](size_t half){
+                if(half == 0){
+                    select_partitions<Geometry>(slots, slots_index, count, first_partition, mid, comp, threads / 2);
+                }
+                else{
+                    select_partitions<Geometry>(slots, slots_index, count, mid, last_partition, comp, threads - threads / 2);
+                }
+            });
+        }
+        else{
+            select_partitions<Geometry>(slots, slots_index, count, first_partition, mid, comp);
+            select_partitions<Geometry>(slots, slots_index, count, mid, last_partition, comp);
+        }
+    }
+}
+
 const size_t MIN_HEAPARRAY_ALLOCATION = 4;  // TODO: Make this more realistic (based on real cache sizes, etc)
+const size_t MIN_PARALLEL_SLOTS       = size_t{1} << 16;                                            // smallest share of a rebuild worth a thread
+const size_t FIND_GROUP_SIZE          = 16;                                                         // keys searched in lockstep by `find_many`
+const size_t FIND_SORT_BYTES          = size_t{32} << 20;                                           // past this size, `find_many` groups its scans
+
+/**
+ * Storage policy (the default): all values live in one contiguous block, which
+ * is re-allocated (and its contents moved) when the HeapArray grows.
+ */
+struct contiguous_storage{};
+
+/**
+ * Storage policy: values live in a list of separately allocated blocks (segments),
+ * each holding a run of whole partitions.  Growing adds a segment (about as large as
+ * everything allocated so far), and existing values never move, so there is no
+ * re-allocation stall and no moment where old and new copies coexist.  Each
+ * partition is still contiguous, so per-partition work (heap operations, searches)
+ * runs exactly as in contiguous storage; work on a run of partitions (such as the
+ * rebuild after a bulk operation) pays a small cost for the indirection.
+ * Memory-mapping an image (`open_mapped`) requires contiguous storage.
+ */
+struct segmented_storage{};
+
+/**
+ * @brief   Geometry policy:  partition `p` holds `Scale * (2p + 1)` values, starting
+ *          at slot `Scale * p * p`.
+ * @details The partition sizes trade the cost of a ripple (one step per partition, so
+ *          fewer, larger partitions ripple faster) against the cost of a scan inside a
+ *          partition (which grows with its size).  `Scale` = 1 (`square_geometry`, the
+ *          default) balances the two in element counts.  A larger `Scale` makes each
+ *          partition a whole number of cache lines or pages (see `cache_line_geometry`),
+ *          so a scan reads whole lines and the hardware prefetcher sees longer runs; the
+ *          cost is about `sqrt(Scale)` times more work per search, in return for about
+ *          `sqrt(Scale)` times fewer partitions to ripple through.  tests/profile_heaparray
+ *          reports the fastest scale for several sizes on the machine it runs on.
+ *
+ *          A geometry policy is any type with these static member functions, where
+ *          `start(p + 1) == start(p) + size(p)` and `start(0) == 0`:
+ *              size_t start(size_t p)        the slot index partition `p` starts at
+ *              size_t size(size_t p)         the number of slots in partition `p`
+ *              size_t partition_of(size_t i) the partition holding slot `i`
+ *          They are resolved at compile time, so a geometry has no runtime cost beyond
+ *          its arithmetic (with a power-of-two `Scale`, one extra shift).
+ *
+ * @tparam  Scale  the number of values per unit of the square geometry (at least 1)
+ */
+template <size_t Scale>
+struct scaled_geometry{
+    static_assert(Scale > 0, "A partition geometry must have a positive scale.");
+
+    static constexpr size_t start(size_t p)        { return Scale * p * p;                   }
+    static constexpr size_t size(size_t p)         { return Scale * (2 * p + 1);             }
+    static size_t           partition_of(size_t i) { return _heaparray::isqrt(i / Scale);    }
+};
+
+/**
+ * Geometry policy (the default):  partition `p` holds `2p + 1` values, starting at
+ * slot `p * p`.
+ */
+typedef scaled_geometry<1> square_geometry;
+
+/**
+ * Geometry policy:  `Bytes / sizeof(DataType)` values per unit (cache lines by default;
+ * pass 4096 for pages).  When `sizeof(DataType)` divides `Bytes` (as for any power-of-two
+ * size up to `Bytes`), each partition holds a whole number of `Bytes`-byte blocks;
+ * otherwise the unit is rounded down, and a partition only approximately fills its blocks.
+ */
+template <typename DataType, size_t Bytes = 64>
+using cache_line_geometry = scaled_geometry<(Bytes / sizeof(DataType) > 0 ? Bytes / sizeof(DataType) : 1)>;
+
+/**
+ * The public operations a statistics policy's `begin` and `end` hooks are called
+ * around (`contains` and `contains_many` count as `find` and `find_many`, and
+ * `split_at` and `split_at_rank` as `split`).
+ */
+enum class heaparray_op : uint8_t{
+    insert, insert_bulk, remove, remove_bulk, erase_if, pop_min, pop_max, find, find_many, merge, split
+};
+
+/**
+ * Get the name of an operation (as used by `counting_stats::write`).
+ * @param  op  the operation
+ * @return its name, such as "insert"
+ */
+inline const char* heaparray_op_name(heaparray_op op){
+    static const char* const names[] = {"insert", "insert_bulk", "remove", "remove_bulk", "erase_if",
+                                        "pop_min", "pop_max", "find", "find_many", "merge", "split"};
+    return names[static_cast<size_t>(op)];
+}
+
+/**
+ * Statistics policy (the default):  counts nothing.  Every hook is an empty inline
+ * function, so the instrumentation compiles away entirely.
+ *
+ * A statistics policy is any type with these members (for example one deriving from
+ * `counting_stats`, feeding a metrics pipeline), which the HeapArray calls as it works:
+ *  - `begin(op)`, `end(op)`:  around each public operation `op` (a `heaparray_op`)
+ *  - `ripple(p)`:  an insert or remove rippled across `p` partitions
+ *  - `scan(n)`:    a search scanned `n` values of partitions
+ *  - `search(s)`:  a partition search took `s` binary-search steps
+ *  - `resize(b)`:  the storage was resized (grown, reserved or shrunk), copying `b` bytes
+ *
+ * Each HeapArray has its own statistics (see `HeapArray::statistics`):  they aren't
+ * copied or moved along with the values.
+ */
+struct no_stats{
+    void begin(heaparray_op){}
+    void end(heaparray_op){}
+    void ripple(size_t){}
+    void scan(size_t){}
+    void search(size_t){}
+    void resize(size_t){}
+};
+
+/**
+ * Statistics policy:  counts the operations and the work they do, keeping each kind
+ * of work as a histogram (so the tail, not just the mean, shows).  Optional hooks
+ * (`on_begin`, `on_end`) are called around each public operation, to time them. `write`
+ * exports everything as text, one "name value" line per counter.
+ */
+class counting_stats{
+public:
+    /**
+     * A histogram in power-of-two buckets:  bucket 0 counts zeros, and bucket `b`
+     * counts the values from `2^(b-1)` to `2^b - 1`.
+     */
+    struct histogram{
+        static constexpr size_t BUCKETS = 65;
+        uint64_t buckets[BUCKETS] = {};
+        uint64_t samples          = 0;
+        uint64_t total            = 0;
+
+        void record(uint64_t value){
+            size_t b = 0;
+            while(b < 64 && value >> b){
+                ++b;
+            }
+            ++buckets[b];
+            ++samples;
+            total += value;
+        }
+        double mean()const{ return samples > 0 ? static_cast<double>(total) / samples : 0.0; }
+    };
+
+    static constexpr size_t OPERATIONS = static_cast<size_t>(heaparray_op::split) + 1;
+
+    uint64_t  operations[OPERATIONS] = {};                                                          // calls of each public operation
+    histogram ripples;                                                                              // partitions crossed per ripple
+    histogram scans;                                                                                // values scanned per search
+    histogram searches;                                                                             // binary-search steps per partition search
+    uint64_t  resizes      = 0;                                                                     // storage resizes, and the bytes
+    uint64_t  bytes_copied = 0;                                                                     // they copied
+
+    std::function<void(heaparray_op)> on_begin;                                                     // called (if set) before and after
+    std::function<void(heaparray_op)> on_end;                                                       // each public operation
+
+    void begin(heaparray_op op){
+        ++operations[static_cast<size_t>(op)];
+        if(on_begin){
+            on_begin(op);
+        }
+    }
+    void end(heaparray_op op){
+        if(on_end){
+            on_end(op);
+        }
+    }
+    void ripple(size_t partitions){ ripples.record(partitions); }
+    void scan(size_t values){ scans.record(values); }
+    void search(size_t steps){ searches.record(steps); }
+    void resize(size_t bytes){
+        ++resizes;
+        bytes_copied += bytes;
+    }
+
+    /**
+     * Clear every counter (the hooks are kept).
+     */
+    void reset(){
+        auto begin_hook = std::move(on_begin);
+        auto end_hook   = std::move(on_end);
+        *this    = counting_stats();
+        on_begin = std::move(begin_hook);
+        on_end   = std::move(end_hook);
+    }
+
+    /**
+     * @brief   Write every counter as text, one "name value" line each.
+     * @details Operations are written as `<prefix>_<op>_total`, histograms as
+     *          `<prefix>_<name>_count`, `_sum` and one `_bucket{le="<bound>"}` line per
+     *          non-empty bucket (counting the samples no greater than `bound`, as in the
+     *          Prometheus text format), and the resizes as `<prefix>_resizes_total` and
+     *          `<prefix>_bytes_copied_total`.
+     *
+     * @param out     the stream to write to
+     * @param prefix  the prefix of every name
+     */
+    void write(std::ostream& out, const std::string& prefix = "heaparray")const{
+        for(size_t op = 0; op < OPERATIONS; ++op){
+            out << prefix << '_' << heaparray_op_name(static_cast<heaparray_op>(op)) << "_total " << operations[op] << '\n';
+        }
+        std::pair<const char*, const histogram*> histograms[] = {{"ripple_partitions", &ripples}, {"scanned_values", &scans},
+                                                                 {"search_steps", &searches}};
+        for(auto& h : histograms){
+            uint64_t cumulative = 0;
+            for(size_t b = 0; b < histogram::BUCKETS; ++b){
+                cumulative += h.second->buckets[b];
+                if(h.second->buckets[b] > 0){
+                    out << prefix << '_' << h.first << "_bucket{le=\"" << (b == 0 ? 0 : b == 64 ? ~uint64_t{0} : (uint64_t{1} << b) - 1)
+                        << "\"} " << cumulative << '\n';
+                }
+            }
+            out << prefix << '_' << h.first << "_bucket{le=\"+Inf\"} " << h.second->samples << '\n';
+            out << prefix << '_' << h.first << "_count " << h.second->samples << '\n';
+            out << prefix << '_' << h.first << "_sum " << h.second->total << '\n';
+        }
+        out << prefix << "_resizes_total " << resizes << '\n';
+        out << prefix << "_bytes_copied_total " << bytes_copied << '\n';
+    }
+};
+
+namespace _heaparray{
+    /*
+     * calls a statistics policy's `begin(op)` when constructed and `end(op)` when
+     * destroyed, around a public operation (however the operation returns)
+     */
+    template <typename Stats>
+    struct stats_scope{
+        stats_scope(Stats& s, heaparray_op o) : stats(s), op(o){ stats.begin(op); }
+        ~stats_scope(){ stats.end(op); }
+        stats_scope(const stats_scope&) = delete;
+        stats_scope& operator=(const stats_scope&) = delete;
+
+        Stats&       stats;
+        heaparray_op op;
+    };
+}
 
 /**
  * An array segmented into sqrt(N) min-max
@@ -48,51 +692,345 @@ const size_t MIN_HEAPARRAY_ALLOCATION = 4;  // TODO: Make this more realistic (b
  * @tparam  DataType    the type of data stored in the heap - must be
  *                      DefaultConstructable, LessThanComparable, Swappable,
  *                      CopyConstructable, and CopyAssignable
+ * @tparam  Compare     the type of the function object that orders the values
+ *                      (`std::less<DataType>` by default); `min()` and `max()`
+ *                      are the first and last values in this order, so
+ *                      `std::greater<DataType>` gives a max-first HeapArray
+ *                      (see `MaxHeapArray`)
+ * @tparam  Equal       the type of the function object used to match values in
+ *                      `contains()`, `remove()` and friends (`std::equal_to<DataType>`
+ *                      by default); must agree with `Compare`
+ * @tparam  Allocator   the allocator used for the storage (`std::allocator<DataType>`
+ *                      by default); only live values are constructed in it, so the
+ *                      `storage - count` spare slots cost nothing to allocate.  The
+ *                      allocator's `pointer` must be a plain `DataType*`.
+ * @tparam  Storage     the storage policy: `contiguous_storage` (the default) or
+ *                      `segmented_storage` (see `SegmentedHeapArray`)
+ * @tparam  Geometry    the partition geometry: `square_geometry` (the default:
+ *                      partition `p` holds `2p+1` values) or another geometry policy,
+ *                      such as `scaled_geometry<Scale>` or `cache_line_geometry<DataType>`
+ * @tparam  Stats       the statistics policy: `no_stats` (the default, compiled out),
+ *                      `counting_stats`, or a user-provided policy (see `no_stats`)
  */
-template <typename DataType>
+template <typename DataType, typename Compare = std::less<DataType>, typename Equal = std::equal_to<DataType>,
+          typename Allocator = std::allocator<DataType>, typename Storage = contiguous_storage, typename Geometry = square_geometry,
+          typename Stats = no_stats>
 class HeapArray{
 public:
+    class ordered_iterator;
+
     HeapArray() = default;
-    HeapArray(const HeapArray<DataType>& rhs);
-    HeapArray(HeapArray<DataType>&& rhs);
-    HeapArray<DataType>& operator=(const HeapArray<DataType>& rhs);
-    HeapArray<DataType>& operator=(HeapArray<DataType>&& rhs);
-    HeapArray(size_t reserve_size, bool allow_resize = true);
-    HeapArray(DataType* begin, DataType* end, DataType* physical_end=nullptr, bool allow_resize = true);
+    HeapArray(const HeapArray& rhs);
+    HeapArray(HeapArray&& rhs);
+    HeapArray& operator=(const HeapArray& rhs);
+    HeapArray& operator=(HeapArray&& rhs);
+    explicit HeapArray(const Allocator& allocator);
+    HeapArray(size_t reserve_size, bool allow_resize, const Allocator& allocator);
+    explicit HeapArray(const Compare& compare, const Equal& equality = Equal(), const Allocator& allocator = Allocator());
+    HeapArray(size_t reserve_size, bool allow_resize = true, const Compare& compare = Compare(), const Equal& equality = Equal(),
+              const Allocator& allocator = Allocator());
+    HeapArray(DataType* begin, DataType* end, DataType* physical_end=nullptr, bool allow_resize = true,
+              const Compare& compare = Compare(), const Equal& equality = Equal(), const Allocator& allocator = Allocator());
+#if defined(__cpp_lib_execution)
+    template <typename ExecutionPolicy,
+              typename = typename std::enable_if<std::is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value>::type>
+    HeapArray(ExecutionPolicy&& policy, DataType* begin, DataType* end, DataType* physical_end=nullptr, bool allow_resize = true,
+              const Compare& compare = Compare(), const Equal& equality = Equal(), const Allocator& allocator = Allocator());
+#endif
     ~HeapArray();
 
-    void                    insert(DataType value);
+    Allocator               get_allocator()const;
+
+    void                    insert(const DataType& value);
+    void                    insert(DataType&& value);
+    template <typename... Args>
+    void                    emplace(Args&&... args);
+    template <typename ForwardIterator>
+    void                    insert_bulk(ForwardIterator first, ForwardIterator last);
     bool                    remove(const DataType& value);
-    DataType                min()const;
-    DataType                max()const;
+    template <typename ForwardIterator>
+    size_t                  remove_bulk(ForwardIterator first, ForwardIterator last);
+    template <typename Predicate>
+    size_t                  erase_if(Predicate pred);
+    void                    merge(HeapArray&& other);
+    HeapArray               split_at(const DataType& value);
+    HeapArray               split_at_rank(size_t k);
+#if defined(__cpp_lib_execution)
+    template <typename ExecutionPolicy, typename ForwardIterator>
+    typename std::enable_if<std::is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value>::type
+                            insert_bulk(ExecutionPolicy&& policy, ForwardIterator first, ForwardIterator last);
+    template <typename ExecutionPolicy, typename ForwardIterator>
+    typename std::enable_if<std::is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, size_t>::type
+                            remove_bulk(ExecutionPolicy&& policy, ForwardIterator first, ForwardIterator last);
+    template <typename ExecutionPolicy, typename Predicate>
+    typename std::enable_if<std::is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, size_t>::type
+                            erase_if(ExecutionPolicy&& policy, Predicate pred);
+#endif
+    const DataType&         min()const;
+    const DataType&         max()const;
+    DataType                pop_min();
+    DataType                pop_max();
+    template <typename OutputIterator>
+    OutputIterator          top_k_smallest(size_t k, OutputIterator out)const;
+    template <typename OutputIterator>
+    OutputIterator          top_k_largest(size_t k, OutputIterator out)const;
+    size_t                  count_range(const DataType& lo, const DataType& hi)const;
+    size_t                  rank(const DataType& value)const;
+    DataType                select(size_t k)const;
+    DataType                median()const;
+    std::pair<const DataType&, const DataType&>
+                            approx_quantile(double q)const;
+    template <typename Function>
+    Function                for_each_in_range(const DataType& lo, const DataType& hi, Function f)const;
+    ordered_iterator        ordered_begin()const;
+    ordered_iterator        ordered_lower_bound(const DataType& value)const;
+    ordered_iterator        ordered_end()const;
     std::pair<bool, size_t> find(const DataType& value)const;
     bool                    contains(const DataType& value)const;
-    DataType                operator[](size_t index)const;
+    void                    find_many(const DataType* keys, size_t k, std::pair<bool, size_t>* results)const;
+    void                    contains_many(const DataType* keys, size_t k, bool* results)const;
+    const DataType&         operator[](size_t index)const;
     size_t                  size()const;
+    size_t                  capacity()const;
+    void                    reserve(size_t slots);
+    void                    shrink_to_fit();
+    HeapArray               clone(bool shrink_to_fit = false)const;
+    void                    set_lazy_remove(bool enable, double compact_threshold = 0.25);
+    bool                    lazy_remove()const;
+    void                    compact();
+    void                    set_bounds_cache(bool enable);
+    void                    set_membership_filter(bool enable);
+    bool                    membership_filter()const;
+    Stats&                  statistics();
+    const Stats&            statistics()const;
+    static HeapArray        open_mapped(const std::string& path, bool allow_resize = true,
+                                        const Compare& compare = Compare(), const Equal& equality = Equal());
+    bool                    mapped()const;
+    void                    sync();
+    void                    save(const std::string& path)const;
+    void                    serialize(std::ostream& out, bool checksum = true)const;
+    void                    serialize(std::vector<char>& buffer, bool checksum = true)const;
+    void                    deserialize(std::istream& in);
+    size_t                  deserialize(const void* data, size_t size);
 
 protected:
-    void                    _init_heaps();
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef std::pair<DataType*, DataType*>  run;                                                   // a range of values, [first, second)
+    static constexpr bool segmented = std::is_same<Storage, segmented_storage>::value;
+    static constexpr bool counting  = !std::is_same<Stats, no_stats>::value;
+
+    DataType*               _partition_data(size_t p)const;
+    DataType*               _address(size_t i)const;
+    DataType&               _slot(size_t i)const;
+    auto                    _slot_iterator(size_t i)const;
+    void                    _allocate(size_t slots);
+    void                    _add_segment(size_t partitions);
+    template <typename... Args>
+    void                    _construct(size_t i, Args&&... args);
+    void                    _destroy(size_t first, size_t last);
+    void                    _release();
+    void                    _copy_settings(const HeapArray& rhs);
+    void                    _copy_values(const HeapArray& rhs);
+    _heaparray::image_header* _image_header()const;
+    void                    _remap(size_t slots);
+    void                    _unmap();
+    template <typename Sink>
+    void                    _write_image(Sink sink, bool checksum)const;
+    template <typename Source>
+    void                    _read_image(Source source, size_t available);
+    void                    _build(DataType* begin, DataType* end, DataType* physical_end, bool allow_resize, size_t threads);
+    template <typename ForwardIterator>
+    void                    _insert_bulk(ForwardIterator first, ForwardIterator last, size_t threads);
+    template <typename ForwardIterator>
+    size_t                  _remove_bulk(ForwardIterator first, ForwardIterator last, size_t threads);
+    void                    _init_heaps(size_t first_partition = 0, size_t threads = 1);
+    void                    _select_partitions(size_t first_partition, size_t last_partition, size_t threads = 1);
+    void                    _heapify_partitions(size_t first_partition, size_t last_partition);
     void                    _resize(size_t new_size, bool round_up = true);
     void                    _grow();
     size_t                  _final_partition()const;
+    void                    _set_count(size_t new_count);
     size_t                  _find_partition(const DataType& value, bool for_insert=false)const;
+    size_t                  _lower_bound_partition(const DataType& value)const;
+    size_t                  _upper_bound_partition(const DataType& value)const;
+    size_t                  _live_in_partition(size_t p)const;
+    size_t                  _live_before(size_t p)const;
+    size_t                  _select_partition(size_t k)const;
     size_t                  _partition_start(size_t p)const;
     size_t                  _partition_end(size_t p)const;
     size_t                  _count_in_partition(size_t p)const;
     size_t                  _partition_size(size_t p)const;
     size_t                  _index_to_partition(size_t i)const;
-    std::pair<DataType,DataType>
+    std::pair<const DataType&, const DataType&>
                             _range_in_partition(size_t p)const;
-    DataType                _max_in_partition(size_t p)const;
+    const DataType&         _max_in_partition(size_t p)const;
+    void                    _update_bounds(size_t p, size_t p_count);
+    void                    _update_bounds_from(size_t first_partition);
+    uint64_t                _filter_hash(const DataType& value)const;
+    void                    _filter_added(uint64_t hash);
+    void                    _filter_removed(const DataType& value);
+    void                    _rebuild_filter();
     std::tuple<bool, size_t, size_t, size_t>
                             _find(const DataType& value)const;
+    std::tuple<bool, size_t, size_t, size_t>
+                            _find_in(const DataType& value, size_t p)const;
+    template <typename Report>
+    void                    _find_group(const DataType* keys, size_t k, Report report)const;
+    const void*             _probe_address(size_t p)const;
+    size_t                  _first_live_partition()const;
+    size_t                  _heap_count(size_t p)const;
+    DataType                _pop_head(size_t offset);
+    bool                    _is_dead(size_t i)const;
+    void                    _mark_dead(size_t i);
+    void                    _clear_dead(size_t i);
+    size_t                  _next_dead(size_t first, size_t last)const;
+    void                    _fill_dead(size_t p, size_t i, DataType&& value);
+    template <typename Predicate>
+    size_t                  _erase_from(size_t first_partition, Predicate is_victim_value, size_t threads = 1);
+    void                    _append_runs(const std::vector<run>& first_runs, const std::vector<run>& second_runs);
+    HeapArray               _split(size_t p, size_t keep);
 
+    Compare   comp;                                                                                 // orders the values
+    Equal     equal;                                                                                // matches values in searches
+    Allocator alloc;                                                                                // provides the (uninitialized) storage
     size_t    storage = 0;
     size_t    count   = 0;
+    size_t    final_p = 0;                                                                          // cached `_final_partition()`
     bool      fixed   = false;
-    DataType* a       = nullptr;
+    mutable Stats stats;                                                                            // counts the work done (see `no_stats`)
+    DataType* a       = nullptr;                                                                    // the values (contiguous storage)
+
+    std::vector<std::pair<DataType*, size_t>> segments;                                             // the blocks (segmented storage), and
+    std::vector<DataType*>                    directory;                                            // the address of each partition in them
+
+    int       map_fd    = -1;                                                                       // the image file (memory-mapped HeapArrays),
+    void*     map_base  = nullptr;                                                                  // and its mapping: the header, followed by
+    size_t    map_bytes = 0;                                                                        // the values (at `a`)
+
+    bool                  lazy           = false;                                                  // lazy (tombstone) removal mode:
+    double                lazy_threshold = 0.25;                                                   // dead fraction that triggers compaction
+    size_t                dead_count     = 0;                                                      // number of dead slots below `count`
+    size_t                dead_first     = 0;                                                      // lowest and highest dead slot indices
+    size_t                dead_last      = 0;                                                      // (only valid if dead_count > 0)
+    std::vector<uint64_t> tombstones;                                                              // one bit per slot, set if dead
+    bool                  head_valid     = false;                                                  // `pop_min` drains the front partition:
+    size_t                head_p         = 0;                                                      // partitions before `head_p` are all dead,
+    size_t                head_dead      = 0;                                                      // as are the last `head_dead` slots of it
+
+    bool                  cache_bounds   = std::is_trivially_copyable<DataType>::value;            // keep a compact per-partition
+    std::vector<std::pair<DataType,DataType>> bounds;                                              // (min, max) index for the partition search
+    bool                       filtering = false;                                                   // keep a membership filter of the live
+    _heaparray::counting_filter membership;                                                         // values, to reject absent ones early
+};
+
+/**
+ * @brief   Walks the values of a HeapArray in ascending order.
+ * @details Partitions are ordered, so an ascending walk reads them one at a time:  the
+ *          live values of the current partition are copied into a buffer arranged as a
+ *          heap, and each step extracts the next smallest one (O(lg(sqrt(n)))).  Nothing
+ *          past the current partition is read, so a walk that stops early (a range query,
+ *          or the first few values past a `ordered_lower_bound`) pays only for the
+ *          partitions it reaches, and never sorts anything.
+ *
+ *          An input iterator over copies of the values, so it stays valid, and keeps
+ *          yielding the values of the current partition, if the HeapArray is modified;
+ *          moving into the next partition after a modification reads the partition at
+ *          that position at the time.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+class HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::ordered_iterator{
+public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef DataType                value_type;
+    typedef std::ptrdiff_t          difference_type;
+    typedef const DataType*         pointer;
+    typedef const DataType&         reference;
+
+    ordered_iterator() = default;
+    reference operator*()const{ return buffer.back(); }
+    pointer   operator->()const{ return &buffer.back(); }
+    ordered_iterator& operator++(){
+        buffer.pop_back();
+        if(buffer.empty()){
+            _load(nullptr);
+        }
+        else{
+            std::pop_heap(buffer.begin(), buffer.end(), later{owner->comp});                         // (the next smallest goes to the back)
+        }
+        return *this;
+    }
+    ordered_iterator operator++(int){ auto old = *this; ++*this; return old; }
+    bool operator==(const ordered_iterator& rhs)const{
+        return buffer.empty() ? rhs.buffer.empty()
+                              : owner == rhs.owner && partition == rhs.partition && buffer.size() == rhs.buffer.size();
+    }
+    bool operator!=(const ordered_iterator& rhs)const{ return !(*this == rhs); }
+
+private:
+    friend class HeapArray;
+
+    struct later{                                                                                   // (makes the std heap a min-heap)
+        Compare comp;
+        bool operator()(const DataType& lhs, const DataType& rhs)const{
+            return comp(rhs, lhs);
+        }
+    };
+
+    ordered_iterator(const HeapArray* o, size_t first_partition, const DataType* lower) : owner(o), partition(first_partition){
+        _load(lower);
+    }
+
+    /*
+     * loads the live values of the next partition that has any (those not less than
+     * `*lower`, if given) into the buffer, with the smallest at the back
+     */
+    void _load(const DataType* lower){
+        while(buffer.empty() && owner->count > 0 && partition <= owner->_final_partition()){
+            auto start = owner->_partition_start(partition);
+            for(auto i = start; i < start + owner->_count_in_partition(partition); ++i){
+                if(!owner->_is_dead(i) && (!lower || !owner->comp(owner->_slot(i), *lower))){
+                    buffer.push_back(owner->_slot(i));
+                }
+            }
+            ++partition;
+        }
+        if(!buffer.empty()){
+            std::make_heap(buffer.begin(), buffer.end(), later{owner->comp});
+            std::pop_heap(buffer.begin(), buffer.end(), later{owner->comp});
+        }
+    }
+
+    const HeapArray*      owner     = nullptr;
+    size_t                partition = 0;                                                            // the partition after the buffered one
+    std::vector<DataType> buffer;                                                                   // the rest of it, as a heap
 };
 
+/**
+ * Construct an empty HeapArray that takes its storage from `allocator` (for
+ * example a `std::pmr::polymorphic_allocator` bound to an arena).
+ *
+ * @param allocator the allocator to use for all storage
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::HeapArray(const Allocator& allocator)
+    : alloc(allocator){
+}
+
+/**
+ * Construct an empty HeapArray that orders its values with `compare` (and
+ * matches them in searches with `equality`) in place of the default-constructed
+ * function objects.
+ *
+ * @param compare   the comparison function object; `compare(x, y)` must induce a strict weak ordering
+ * @param equality  the equality function object; must agree with `compare` (`equality(x, y)`
+ *                  only if neither `compare(x, y)` nor `compare(y, x)`)
+ * @param allocator the allocator to use for all storage (default-constructed if not given)
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::HeapArray(const Compare& compare, const Equal& equality, const Allocator& allocator)
+    : comp(compare), equal(equality), alloc(allocator){
+}
+
 /**
  * construct HeapArray given a specfic size (number of elements) to reserve.
  * The size may be set to "static" (which dis-allows all dynamic resizing) by
@@ -100,14 +1038,32 @@ protected:
  *
  * @param reserve_size number of elements to reserve for the HeapArray
  * @param allow_resize flag representing whether or not the HeapArray is allowed to dynamically resize
+ * @param compare      the comparison function object (default-constructed if not given)
+ * @param equality     the equality function object (default-constructed if not given)
+ * @param allocator    the allocator to use for all storage (default-constructed if not given)
  */
-template <typename DataType>
-HeapArray<DataType>::HeapArray(size_t reserve_size, bool allow_resize){
-    a       = new DataType[reserve_size];
-    storage = reserve_size;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::HeapArray(size_t reserve_size, bool allow_resize, const Compare& compare, const Equal& equality,
+                                                          const Allocator& allocator)
+    : comp(compare), equal(equality), alloc(allocator){
+    _allocate(reserve_size);                                                                        // (no values are constructed yet)
     fixed   = !allow_resize;
 }
 
+/**
+ * Construct a HeapArray given a specific size (number of elements) to reserve,
+ * taking all storage from `allocator` (for example a `hugepage_allocator`
+ * configured for huge pages and NUMA placement).
+ *
+ * @param reserve_size number of elements to reserve for the HeapArray
+ * @param allow_resize flag representing whether or not the HeapArray is allowed to dynamically resize
+ * @param allocator    the allocator to use for all storage
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::HeapArray(size_t reserve_size, bool allow_resize, const Allocator& allocator)
+    : HeapArray(reserve_size, allow_resize, Compare(), Equal(), allocator){
+}
+
 /**
  * Construct a HeapArray given pointers to the beginning and end of an existing
  * array, by copy.
@@ -117,25 +1073,60 @@ HeapArray<DataType>::HeapArray(size_t reserve_size, bool allow_resize){
  * @param end           pointer to the address following the last data element to copy into the new HeapArray
  * @param physical_end  pointer to the address following the physical end of the array (hints at initial size of the HeapArray)
  * @param allow_resize  flag representing whether or not the HeapArray is allowed to dynamically resize
+ * @param compare       the comparison function object (default-constructed if not given)
+ * @param equality      the equality function object (default-constructed if not given)
+ * @param allocator     the allocator to use for all storage (default-constructed if not given)
  */
-template <typename DataType>
-HeapArray<DataType>::HeapArray(DataType* begin, DataType* end, DataType* physical_end, bool allow_resize){                   // copy existing array (range) into the object
-    auto new_size = physical_end ? physical_end - begin : end - begin;
-    _resize(new_size, allow_resize);                                                                // get space (rounds up only if resize is allowed)
-    std::copy(begin, end, a);                                                                       // copy in the existing range of values
-    count = end - begin;
-    _init_heaps();                                                                                  // and make-heap in each partition
-    fixed = !allow_resize;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::HeapArray(DataType* begin, DataType* end, DataType* physical_end, bool allow_resize,
+                                                          const Compare& compare, const Equal& equality, const Allocator& allocator)
+    : comp(compare), equal(equality), alloc(allocator){                                             // copy existing array (range) into the object
+    _build(begin, end, physical_end, allow_resize, 1);
+}
+
+#if defined(__cpp_lib_execution)
+/**
+ * @brief   Construct a HeapArray from an existing array (by copy), building it in parallel.
+ * @details As `HeapArray(begin, end, ...)`, but under a parallel execution policy
+ *          (`std::execution::par` or `par_unseq`), the partitioning is split across
+ *          threads once the first selection pass has divided the values, and the heaps
+ *          are built in groups of partitions holding about equal numbers of values (later
+ *          partitions are larger, so groups of equal partition counts would be lopsided).
+ *          Under `std::execution::seq` this is the serial build.  To use it, include
+ *          <tt>\<execution\></tt> before <tt>heaparray.h</tt> (or define `HEAPARRAY_EXECUTION`).
+ *
+ * @param policy        the execution policy
+ * @param begin         pointer to the first element of the range to copy into the new HeapArray
+ * @param end           pointer to the address following the last data element to copy into the new HeapArray
+ * @param physical_end  pointer to the address following the physical end of the array (hints at initial size of the HeapArray)
+ * @param allow_resize  flag representing whether or not the HeapArray is allowed to dynamically resize
+ * @param compare       the comparison function object (default-constructed if not given)
+ * @param equality      the equality function object (default-constructed if not given)
+ * @param allocator     the allocator to use for all storage (default-constructed if not given)
+ * @tparam ExecutionPolicy  one of the standard execution policy types
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename ExecutionPolicy, typename>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::HeapArray(ExecutionPolicy&&, DataType* begin, DataType* end, DataType* physical_end, bool allow_resize,
+                                                          const Compare& compare, const Equal& equality, const Allocator& allocator)
+    : comp(compare), equal(equality), alloc(allocator){
+    _build(begin, end, physical_end, allow_resize, _heaparray::policy_threads<ExecutionPolicy>());
 }
+#endif
 
 /**
- * Copy constructor for HeapArray; makes a copy of an existing HeapArray.
+ * Copy constructor for HeapArray; makes a copy of an existing HeapArray, with the
+ * same values in the same layout and the same capacity (the slots past the values
+ * are left unconstructed).  Use `clone(true)` for a copy with its storage shrunk to fit.
  *
  * @param rhs the original HeapArray that will be copied into this new one
  */
-template <typename DataType>
-HeapArray<DataType>::HeapArray(const HeapArray<DataType>& rhs){
-    *this = rhs;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::HeapArray(const HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>& rhs)
+    : alloc(alloc_traits::select_on_container_copy_construction(rhs.alloc)){
+    _allocate(rhs.storage);
+    _copy_settings(rhs);
+    _copy_values(rhs);
 }
 
 /**
@@ -144,27 +1135,38 @@ HeapArray<DataType>::HeapArray(const HeapArray<DataType>& rhs){
  *
  * @param rhs the original HeapArray to move into the new one (rhs is left in an empty state)
  */
-template <typename DataType>
-HeapArray<DataType>::HeapArray(HeapArray<DataType>&& rhs){
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::HeapArray(HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>&& rhs)
+    : alloc(std::move(rhs.alloc)){
     *this = std::move(rhs);
 }
 
 /**
- * Copy assignment operator; makes a complete deep copy of a HeapArray, including all data,
- * the physical allocation size, and the "allow_resize" trait.
+ * Copy assignment operator; makes a complete deep copy of a HeapArray, including all data
+ * (in the same layout), the physical allocation size, and the "allow_resize" trait.
+ * Storage of the same size is reused rather than reallocated, and trivially copyable
+ * values are copied with `memcpy`.
  *
  * @param rhs the original HeapArray to copy into the left-hand operand
  * @return    a reference to the new copy
  */
-template <typename DataType>
-HeapArray<DataType>& HeapArray<DataType>::operator=(const HeapArray<DataType>& rhs){
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>& HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::operator=(const HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>& rhs){
     if(this != &rhs){
-        storage = rhs.storage;
-        count   = rhs.count;
-        fixed   = rhs.fixed;
-        delete [] a;
-        a = new DataType[storage];
-        std::copy(rhs.a, rhs.a+count, a);
+        if(!map_base && storage == rhs.storage
+           && (!alloc_traits::propagate_on_container_copy_assignment::value || alloc == rhs.alloc)){
+            _destroy(0, count);                                                                     // (a replica refreshed from the same
+            count = 0;                                                                              // source keeps its storage)
+        }
+        else{
+            _release();
+            if(alloc_traits::propagate_on_container_copy_assignment::value){
+                alloc = rhs.alloc;
+            }
+            _allocate(rhs.storage);
+        }
+        _copy_settings(rhs);
+        _copy_values(rhs);
     }
     return *this;
 }
@@ -177,17 +1179,54 @@ HeapArray<DataType>& HeapArray<DataType>::operator=(const HeapArray<DataType>& r
  *            operation `rhs` is left in an empty state
  * @return    a reference to the left-hand operand (containing the moved data)
  */
-template <typename DataType>
-HeapArray<DataType>& HeapArray<DataType>::operator=(HeapArray<DataType>&& rhs){
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>& HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::operator=(HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>&& rhs){
     if(this != &rhs){
-        storage     = rhs.storage;
-        count       = rhs.count;
+        _release();
+        if(alloc_traits::propagate_on_container_move_assignment::value){
+            alloc = std::move(rhs.alloc);
+        }
+        final_p     = rhs.final_p;
         fixed       = rhs.fixed;
-        delete [] a;
-        a           = rhs.a;
-        rhs.a       = nullptr;
-        rhs.storage = rhs.count = 0;
+        if(alloc_traits::propagate_on_container_move_assignment::value || alloc == rhs.alloc || rhs.map_base){
+            std::swap(a, rhs.a);                                                                    // the storage can just change hands
+            std::swap(map_fd, rhs.map_fd);                                                          // (as can a mapped image, which doesn't
+            std::swap(map_base, rhs.map_base);                                                      // belong to either allocator)
+            std::swap(map_bytes, rhs.map_bytes);
+            std::swap(segments, rhs.segments);
+            std::swap(directory, rhs.directory);
+            std::swap(storage, rhs.storage);
+            std::swap(count, rhs.count);
+        }
+        else{                                                                                       // otherwise it has to be re-allocated from
+            _allocate(rhs.storage);                                                                 // this allocator, moving each value across
+            for(count = 0; count < rhs.count; ++count){
+                _construct(count, std::move(rhs._slot(count)));
+            }
+        }
+        rhs._release();
+        rhs.final_p = 0;
         rhs.fixed   = false;
+        lazy           = rhs.lazy;
+        lazy_threshold = rhs.lazy_threshold;
+        dead_count     = rhs.dead_count;
+        dead_first     = rhs.dead_first;
+        dead_last      = rhs.dead_last;
+        tombstones     = std::move(rhs.tombstones);
+        head_valid     = rhs.head_valid;
+        head_p         = rhs.head_p;
+        head_dead      = rhs.head_dead;
+        rhs.dead_count = 0;
+        rhs.tombstones.clear();
+        rhs.head_valid = false;
+        cache_bounds   = rhs.cache_bounds;
+        bounds         = std::move(rhs.bounds);
+        rhs.bounds.clear();
+        filtering      = rhs.filtering;
+        membership     = std::move(rhs.membership);
+        rhs.filtering  = false;
+        comp           = std::move(rhs.comp);
+        equal          = std::move(rhs.equal);
     }
     return *this;
 }
@@ -195,67 +1234,634 @@ HeapArray<DataType>& HeapArray<DataType>::operator=(HeapArray<DataType>&& rhs){
 /**
  * Destroy the HeapArray; deallocates all memory associated with the data structure.
  */
-template <typename DataType>
-HeapArray<DataType>::~HeapArray(){
-    delete [] a;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::~HeapArray(){
+    _release();
+}
+
+/**
+ * Get a copy of the allocator used for the HeapArray's storage.
+ * @return the allocator
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+Allocator HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::get_allocator()const{
+    return alloc;
 }
 
 /**
  * Get the logical size (number of elements) for the HeapArray
  * @return the current number of elements contained in the HeapArray
  */
-template <typename DataType>
-inline size_t HeapArray<DataType>::size()const {
-    return count;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::size()const {
+    return count - dead_count;
 }
 
 /**
- * @brief   read-only random access
- * @details provides read-only access directly to the underlying array
+ * Get the number of values the HeapArray has storage for, without growing.
+ * @return the physical size of the storage, in values (dead slots included)
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::capacity()const{
+    return storage;
+}
+
+/**
+ * @brief   Make room for at least `slots` values, so that inserts up to that size never grow.
+ * @details Does nothing if the storage is already large enough; otherwise the storage is
+ *          reallocated once (rounded up to the end of a partition) and the values moved
+ *          across, keeping their layout.  In segmented storage nothing moves.
  *
- * @param  index index to read
- * @return item stored at `index` (by value)
- * @throws std::out_of_range is thrown if `index` is beyond the end of the logical
- *         size of the HeapArray
+ * @param  slots  the number of values to make room for
+ * @throws std::length_error  if more room is needed and the container isn't allowed to resize
  */
-template <typename DataType>
-DataType  HeapArray<DataType>::operator[](size_t index)const{
-    if(index >= count){
-        throw std::out_of_range("Index out of range.");
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::reserve(size_t slots){
+    if(slots <= storage){
+        return;
+    }
+    if(fixed){
+        throw std::length_error("Maximum size exceeded for fixed-size container.");
     }
-    return a[index];
+    _resize(slots);
 }
 
 /**
- * @brief   Insert a new item into the HeapArray.
- * @details Inserts a new value.  If the container is full, inserting a new item
- *          will increase its size unless the "allow_resize" option is set to
- *          `false`, in which case the insert will fail with a std::length_error
- *          exception.
- * @param   value  the new value to insert
- * @throws  std::length_error  if the container is already full and isn't allowed to resize
+ * @brief   Release the storage past the end of the final partition.
+ * @details Contiguous storage is reallocated to fit (the values moved across, keeping
+ *          their layout), and segmented storage frees each trailing segment that holds
+ *          no values.  Does nothing for a fixed-size HeapArray, whose capacity is part of
+ *          its contract, or if there is nothing to release.  Dead slots (from lazy
+ *          removal) are kept; call `compact()` first to release them, too.
  */
-template <typename DataType>
-void HeapArray<DataType>::insert(DataType value){
-    if(count == storage){                                                                           // if the container is full, resize
-        if(fixed){                                                                                  // unless it is fixed size, in which
-            throw std::length_error("Maximum size exceeded for fixed-size container.");             // case throw an exception
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::shrink_to_fit(){
+    auto fit = count > 0 ? _partition_start(_final_partition() + 1) : 0;                            // (allocations end on a partition boundary)
+    if(fixed || fit >= storage){
+        return;
+    }
+    if constexpr(segmented){
+        while(!segments.empty()){
+            auto first = directory.size();
+            while(directory[--first] != segments.back().first){}                                    // (the segment's first partition)
+            if(count > 0 && first <= _final_partition()){                                           // the segment still holds values
+                break;
+            }
+            alloc_traits::deallocate(alloc, segments.back().first, segments.back().second);
+            segments.pop_back();
+            directory.resize(first);
         }
-        _grow();
+        storage = _partition_start(directory.size());
+        stats.resize(0);
+    }
+    else if(!map_base || fit > 0){                                                                  // (a mapped image keeps its file)
+        _resize(fit);
+    }
+}
+
+/**
+ * @brief   Make a copy of the HeapArray, optionally with its storage shrunk to fit.
+ * @details With `shrink_to_fit` false this is the copy constructor:  the same values in
+ *          the same layout, the same capacity and the same options.  With it true, the
+ *          copy is allocated only up to the end of its final partition, and any dead
+ *          slots (from lazy removal) are dropped, which suits a read-only replica that
+ *          won't grow.  A copy of a fixed-size HeapArray keeps its capacity either way.
+ *
+ * @param  shrink_to_fit  set to `true` to size the copy's storage to its values
+ * @return the copy
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats> HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::clone(bool shrink_to_fit)const{
+    if(!shrink_to_fit || fixed){
+        return HeapArray(*this);
+    }
+    HeapArray result(comp, equal, alloc_traits::select_on_container_copy_construction(alloc));
+    result._allocate(count > 0 ? _partition_start(_final_partition() + 1) : 0);
+    result._copy_settings(*this);
+    result._copy_values(*this);
+    if(result.dead_count > 0){
+        result.compact();
+        result.shrink_to_fit();
+    }
+    return result;
+}
+
+/**
+ * @brief   Enable or disable lazy (tombstone) removal.
+ * @details In lazy mode, `remove` only marks the slot holding the value as dead, so
+ *          removal costs the search plus O(1) instead of the search plus a "ripple".
+ *          Dead slots are skipped by searches and by `min` and `max`, and are compacted
+ *          away in a single pass when the dead fraction reaches `compact_threshold`
+ *          (an insert puts its value, or the value its ripple displaces, into the first
+ *          dead slot it reaches instead, and the ripple stops there).  Disabling lazy
+ *          mode compacts immediately.
+ *          While dead slots remain, `operator[]` indices refer to physical slots (which
+ *          may include removed values); call `compact` first for a dense layout.
+ *
+ * @param enable             `true` to enable lazy removal, `false` to disable it
+ * @param compact_threshold  fraction of dead slots (0.0 to 1.0) that triggers compaction
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::set_lazy_remove(bool enable, double compact_threshold){
+    lazy           = enable;
+    lazy_threshold = compact_threshold;
+    if(!lazy){
+        compact();
+    }
+}
+
+/**
+ * Determine whether lazy (tombstone) removal is enabled.
+ * @return `true` if lazy removal is enabled, `false` otherwise
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline bool HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::lazy_remove()const {
+    return lazy;
+}
+
+/**
+ * @brief   Enable or disable the cached partition bounds.
+ * @details When enabled, the minimum and maximum of every partition are kept in a small
+ *          contiguous side index, so each step of the binary search for a partition reads
+ *          one entry of that index rather than up to three scattered elements of the heaps
+ *          themselves.  The index is refreshed for each partition an insert or remove touches.
+ *          It is enabled by default for trivially copyable types, where refreshing an entry
+ *          is just a couple of copies.
+ *
+ * @param enable  `true` to keep the cached bounds, `false` to compute them on demand
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::set_bounds_cache(bool enable){
+    cache_bounds = enable;
+    bounds.clear();
+    _update_bounds_from(0);
+}
+
+/**
+ * @brief   Enable or disable the membership filter (disabled by default).
+ * @details The filter is a counting Bloom filter of the live values, kept up to date by
+ *          every insert and remove (4 to 8 bytes per value).  `find`, `contains`,
+ *          `remove`, `find_many` and `contains_many` consult it first:  for about 97% of
+ *          absent values it answers "not present" after reading a single cache line,
+ *          skipping the partition search and scan entirely.  Values that pass it are
+ *          searched as usual, so answers never change.  Worth enabling when many lookups
+ *          miss; it adds a little to every insert and remove.
+ *          The filter hashes values with `std::hash<DataType>`, which must agree with
+ *          `Equal` (values that match must hash alike).
+ *
+ * @param enable  `true` to build and keep the filter, `false` to drop it
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::set_membership_filter(bool enable){
+    static_assert(_heaparray::is_hashable<DataType>::value, "The membership filter needs std::hash<DataType>.");
+    filtering = enable;
+    if(enable){
+        _rebuild_filter();
+    }
+    else{
+        membership = _heaparray::counting_filter();
+    }
+}
+
+/**
+ * Determine whether the membership filter is enabled.
+ * @return `true` if it is, `false` otherwise
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline bool HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::membership_filter()const{
+    return filtering;
+}
+
+/**
+ * Get the HeapArray's statistics (see the `Stats` policy), for example to read or
+ * reset the counters of a `counting_stats`, or to set its hooks.
+ * @return a reference to the statistics
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+Stats& HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::statistics(){
+    return stats;
+}
+
+/**
+ * Get the HeapArray's statistics (see the `Stats` policy).
+ * @return a reference to the statistics
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+const Stats& HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::statistics()const{
+    return stats;
+}
+
+/**
+ * Remove all dead slots left behind by lazy removal, in a single pass.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::compact(){
+    if(dead_count > 0){
+        _erase_from(_index_to_partition(dead_first), [](const DataType&){ return false; });
+    }
+}
+
+/**
+ * @brief   Open a HeapArray image file (written by `save`) in place, with no copy.
+ * @details The file is memory-mapped (shared, read-write) and its values are used
+ *          directly as the HeapArray's storage, so opening costs O(1) reads of the data
+ *          plus rebuilding the O(sqrt(N)) bounds cache, whatever the size of the image.
+ *          Every change is made in the file's pages: inserting past the end of the file
+ *          grows the file and maps it again, and `sync()` checkpoints it.  When the
+ *          HeapArray is destroyed (or assigned over), its count is written back into the
+ *          header and the file is closed.  A copy of a mapped HeapArray is an ordinary
+ *          (allocated) one; moving it moves the mapping.
+ *
+ *          Only trivially copyable types can be mapped (the bytes in the file *are* the
+ *          values), and only in contiguous storage.  The image must have been written by a
+ *          HeapArray of the same `DataType` and `Compare`; the header only lets the size of
+ *          `DataType` be checked, and the values themselves are trusted.
+ *
+ * @param  path          the image file to open
+ * @param  allow_resize  flag representing whether or not the HeapArray (and so the file) is allowed to grow
+ * @param  compare       the comparison function object (default-constructed if not given)
+ * @param  equality      the equality function object (default-constructed if not given)
+ * @return a HeapArray holding the mapped image
+ * @throws std::runtime_error if the file can't be opened or mapped, or isn't an image
+ *         of this `DataType`, or if memory-mapping isn't available on this platform
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats> HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::open_mapped(const std::string& path, bool allow_resize,
+                                                                          const Compare& compare, const Equal& equality){
+    static_assert(std::is_trivially_copyable<DataType>::value, "Memory-mapped HeapArrays need a trivially copyable DataType.");
+    static_assert(!segmented, "Memory-mapped HeapArrays need contiguous storage.");
+    static_assert(alignof(DataType) <= sizeof(_heaparray::image_header), "DataType is over-aligned for an image.");
+#if defined(HEAPARRAY_HAS_MMAP)
+    int fd = open(path.c_str(), O_RDWR);
+    if(fd < 0){
+        throw std::runtime_error("Cannot open HeapArray image: " + path);
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(_heaparray::image_header)){
+        close(fd);
+        throw std::runtime_error("Not a HeapArray image: " + path);
+    }
+    auto bytes = size_t(info.st_size);
+    auto base  = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(base == MAP_FAILED){
+        close(fd);
+        throw std::runtime_error("Cannot map HeapArray image: " + path);
+    }
+    auto header = static_cast<_heaparray::image_header*>(base);
+    if(!header->valid<Geometry>(sizeof(DataType))
+       || header->storage > (bytes - sizeof(_heaparray::image_header)) / sizeof(DataType)){         // (a truncated file would fault later)
+        munmap(base, bytes);
+        close(fd);
+        throw std::runtime_error("Not a HeapArray image of this type: " + path);
+    }
+    header->checksum = 0;                                                                           // (the values will change in place)
+    HeapArray result(compare, equality);
+    result.map_fd    = fd;
+    result.map_base  = base;
+    result.map_bytes = bytes;
+    result.a         = reinterpret_cast<DataType*>(static_cast<char*>(base) + sizeof(_heaparray::image_header));
+    result.storage   = header->storage;
+    result._set_count(header->count);
+    result.fixed     = !allow_resize;
+    result._update_bounds_from(0);
+    return result;
+#else
+    (void)path; (void)allow_resize; (void)compare; (void)equality;
+    throw std::runtime_error("Memory-mapped HeapArrays are not supported on this platform.");
+#endif
+}
+
+/**
+ * Is this HeapArray a memory-mapped image (see `open_mapped`)?
+ * @return `true` if the values live in a mapped image file
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline bool HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::mapped()const{
+    return map_base != nullptr;
+}
+
+/**
+ * @brief   Checkpoint a memory-mapped HeapArray to its file.
+ * @details Compacts away any lazily removed values, records the count in the header,
+ *          and flushes the mapping (`msync`), so the file is a complete image once this
+ *          returns.  Does nothing if the HeapArray isn't mapped.
+ *
+ * @throws std::runtime_error if the mapping can't be flushed
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::sync(){
+#if defined(HEAPARRAY_HAS_MMAP)
+    if(map_base){
+        compact();
+        _image_header()->count = count;
+        if(msync(map_base, map_bytes, MS_SYNC) != 0){
+            throw std::runtime_error("Cannot flush the HeapArray image file.");
+        }
+    }
+#endif
+}
+
+/**
+ * @brief   Write the HeapArray to an image file, for `open_mapped`.
+ * @details Writes the header and the values in their partitioned order, leaving out
+ *          any lazily removed values (one sequential write; nothing is rebuilt on either
+ *          side).  The image has no spare slots; a mapped HeapArray grows the
+ *          file when it needs room.  Works with either storage policy.  To checkpoint a
+ *          mapped HeapArray's own file, use `sync()` instead.
+ *
+ * @param  path  the file to write (replaced if it exists)
+ * @throws std::runtime_error if the file can't be written
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::save(const std::string& path)const{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    serialize(out);
+    out.close();
+    if(!out){
+        throw std::runtime_error("Cannot write HeapArray image: " + path);
+    }
+}
+
+/**
+ * @brief   Write a snapshot of the HeapArray to a binary stream.
+ * @details The snapshot is the same image `save` writes: a header (format version,
+ *          value size, count, and optionally a checksum of the values) followed by the
+ *          values in their partitioned order, written in bulk, a partition at a time.
+ *          Reading it back with `deserialize` copies the layout as it is, with no
+ *          re-sort or re-heapify.  Any lazily removed values are left out (the HeapArray
+ *          itself is not compacted).
+ *          Only trivially copyable types can be serialized this way, and only read back
+ *          as the same `DataType` with the same `Compare`, on a machine of the same byte
+ *          order.
+ *
+ * @param out       the stream to write to (opened in binary mode)
+ * @param checksum  `true` to record a checksum (64-bit FNV-1a) of the values, which costs
+ *                  one extra pass over them; `deserialize` verifies it if present
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::serialize(std::ostream& out, bool checksum)const{
+    _write_image([&](const void* data, size_t bytes){ out.write(static_cast<const char*>(data), bytes); }, checksum);
+}
+
+/**
+ * Append a snapshot of the HeapArray (see `serialize(std::ostream&)`) to `buffer`.
+ *
+ * @param buffer    the buffer to append to
+ * @param checksum  `true` to record a checksum of the values
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::serialize(std::vector<char>& buffer, bool checksum)const{
+    buffer.reserve(buffer.size() + sizeof(_heaparray::image_header) + (count - dead_count) * sizeof(DataType));
+    _write_image([&](const void* data, size_t bytes){
+        buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + bytes);
+    }, checksum);
+}
+
+/**
+ * @brief   Replace the contents of the HeapArray with a snapshot read from a binary stream.
+ * @details Reads a snapshot written by `serialize` (or an image written by `save`) in
+ *          bulk, straight into new storage, and uses its layout as it is (the values are
+ *          trusted to be in the order `Compare` gives them; nothing is rebuilt).  The
+ *          checksum is verified if the snapshot has one.  The allocator, the comparison
+ *          and equality objects and the lazy-removal and bounds-cache settings are kept; a
+ *          fixed-size HeapArray keeps its size.
+ *
+ * @param  in  the stream to read from (opened in binary mode)
+ * @throws std::runtime_error if the stream doesn't hold a snapshot of this `DataType`,
+ *         ends early, or fails its checksum, or if there isn't memory for the values
+ *         it claims to hold; the HeapArray is left empty (or, if a seekable stream is
+ *         too short for the count in the header, unchanged)
+ * @throws std::length_error  if the HeapArray is fixed-size and the snapshot doesn't fit
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::deserialize(std::istream& in){
+    auto available = ~size_t(0);
+    auto here      = in.tellg();
+    if(here != std::streampos(-1)){                                                                 // a seekable stream: check the count
+        auto end = in.rdbuf()->pubseekoff(0, std::ios::end, std::ios::in);                          // against what is left in it
+        if(end != std::streampos(-1)){
+            available = static_cast<size_t>(end - here);
+            in.rdbuf()->pubseekpos(here, std::ios::in);
+        }
+    }
+    _read_image([&](void* data, size_t bytes){
+        in.read(static_cast<char*>(data), bytes);
+        return size_t(in.gcount()) == bytes;
+    }, available);
+}
+
+/**
+ * Replace the contents of the HeapArray with a snapshot (see `deserialize(std::istream&)`)
+ * held in a buffer.
+ *
+ * @param  data  the start of the snapshot
+ * @param  size  the number of bytes available at `data`
+ * @return the number of bytes the snapshot occupied
+ * @throws std::runtime_error if the buffer doesn't hold a snapshot of this `DataType`,
+ *         is too short, or fails its checksum; the HeapArray is left empty (or, if the
+ *         buffer is too short for the count in the header, unchanged)
+ * @throws std::length_error  if the HeapArray is fixed-size and the snapshot doesn't fit
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::deserialize(const void* data, size_t size){
+    size_t used = 0;
+    _read_image([&](void* dest, size_t bytes){
+        if(bytes > size - used){
+            return false;
+        }
+        std::memcpy(dest, static_cast<const char*>(data) + used, bytes);
+        used += bytes;
+        return true;
+    }, size);
+    return used;
+}
+
+/**
+ * @brief   read-only random access
+ * @details provides read-only access directly to the underlying array
+ *
+ * @param  index index to read
+ * @return a reference to the item stored at `index` (valid until the HeapArray is next modified)
+ * @throws std::out_of_range is thrown if `index` is beyond the end of the logical
+ *         size of the HeapArray
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+const DataType&  HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::operator[](size_t index)const{
+    if(index >= count){
+        throw std::out_of_range("Index out of range.");
+    }
+    return _slot(index);
+}
+
+/**
+ * @brief   Insert a new item into the HeapArray.
+ * @details Inserts a copy of `value`; see `insert(DataType&&)`.
+ * @param   value  the new value to insert
+ * @throws  std::length_error  if the container is already full and isn't allowed to resize
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::insert(const DataType& value){
+    insert(DataType(value));
+}
+
+/**
+ * @brief   Construct a new item in place and insert it into the HeapArray.
+ * @details The value is constructed once from `args` and then moved (never copied)
+ *          through the insert; see `insert(DataType&&)`.
+ * @param   args  the arguments to pass to `DataType`'s constructor
+ * @tparam  Args  the types of the constructor arguments
+ * @throws  std::length_error  if the container is already full and isn't allowed to resize
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename... Args>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::emplace(Args&&... args){
+    insert(DataType(std::forward<Args>(args)...));
+}
+
+/**
+ * @brief   Insert a new item into the HeapArray.
+ * @details Inserts a new value.  If the container is full, inserting a new item
+ *          will increase its size unless the "allow_resize" option is set to
+ *          `false`, in which case the insert will fail with a std::length_error
+ *          exception.
+ *          The value, and every value displaced by the "ripple" through later
+ *          partitions, is moved rather than copied, so inserting a type that owns
+ *          heap memory (such as `std::string`) allocates nothing along the way.
+ * @param   value  the new value to insert (left in a moved-from state)
+ * @throws  std::length_error  if the container is already full and isn't allowed to resize
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::insert(DataType&& value){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::insert);
+    auto hash      = filtering ? _filter_hash(value) : 0;                                           // (before `value` is moved away)
+    auto partition = _find_partition(value, true);                                                  // find which partition the new value
+    auto first     = partition;                                                                     // belongs in
+    if(head_valid && head_dead > 0 && partition == head_p){                                         // the partition `pop_min` is draining has a
+        auto   start = _partition_start(head_p);                                                    // free slot at the end of its heap, so take
+        size_t n     = _heap_count(head_p);                                                         // that one back: no ripple
+        tombstones[(start + n) / 64] &= ~(uint64_t{1} << ((start + n) % 64));
+        --dead_count;
+        --head_dead;
+        dead_last = dead_last == start + n ? start - 1 : dead_last;                                 // (it may have been the last dead slot)
+        heap_insert(std::move(value), _partition_data(head_p), n, n + 1, comp);
+        _update_bounds(head_p, _count_in_partition(head_p));
+        _filter_added(hash);
+        stats.ripple(1);
+        return;
+    }
+    size_t dead  = count;                                                                           // the ripple stops at the first partition
+    auto   reuse = partition;                                                                       // on its way that has a dead slot (lazy
+    if(dead_count > 0){                                                                             // removal), since whatever reaches that
+        auto last = std::min(_index_to_partition(dead_last), _final_partition());                   // partition belongs in it
+        for(; reuse <= last; ++reuse){
+            auto end  = _partition_start(reuse) + _count_in_partition(reuse);
+            auto slot = _next_dead(_partition_start(reuse), end);
+            if(slot != end){
+                dead = slot;
+                break;
+            }
+        }
+    }
+    if(dead == count && count == storage){                                                          // if the container is full, resize
+        if(fixed){                                                                                  // unless it is fixed size, in which
+            throw std::length_error("Maximum size exceeded for fixed-size container.");             // case throw an exception
+        }
+        _grow();
+    }
+    if(dead == count){
+        _construct(count);                                                                          // the ripple ends by filling the next slot
+    }
+    bool done = false;
+    while(!done && (dead == count || partition < reuse)){                                           // add the value to its partition, and
+        auto p_count = _count_in_partition(partition);                                              // "ripple" the maximum value (which
+        auto ripple  = heap_insert_circular(std::move(value),                                       // will be displaced if the partition is
+                            _partition_data(partition),                                             // non-final and thus full)
+                            p_count,                                                                // down to subsequent partitons,
+                            _partition_size(partition), comp);                                      // until the final partition is reached
+        _update_bounds(partition, p_count);
+        done  = !ripple.first;
+        value = std::move(ripple.second);
+        ++partition;
+    }
+    if(dead != count){                                                                              // or the dead slot is reached, which the
+        _fill_dead(reuse, dead, std::move(value));                                                  // value takes over
+        _update_bounds(reuse, _count_in_partition(reuse));
+        _filter_added(hash);
+        stats.ripple(reuse - first + 1);
+        return;
+    }
+    _set_count(count + 1);
+    _filter_added(hash);
+    stats.ripple(partition - first);
+}
+
+/**
+ * @brief   Insert a batch of new items into the HeapArray.
+ * @details Inserts every value in the range [first, last) in a single pass:  the
+ *          batch is appended to the end of the array, and only the suffix of partitions
+ *          starting with the one that the smallest batch value belongs in is rebuilt
+ *          (partitions before that one are unaffected).  This costs about
+ *          O((n_suffix + k) lg(n_suffix + k)) for a batch of `k` values, rather than
+ *          `k` separate "ripple" inserts.  Pass a range of `std::move_iterator`s to move
+ *          the values in rather than copying them.
+ *          If the container would overflow, it will increase its size unless the
+ *          "allow_resize" option is set to `false`, in which case no values are inserted
+ *          and a std::length_error exception is thrown.
+ * @param   first  iterator to the first value to insert
+ * @param   last   iterator to the position following the last value to insert
+ * @tparam  ForwardIterator  an iterator type satisfying ForwardIterator, whose value
+ *                           type is assignable to `DataType`
+ * @throws  std::length_error  if the batch doesn't fit and the container isn't allowed to resize
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename ForwardIterator>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::insert_bulk(ForwardIterator first, ForwardIterator last){
+    _insert_bulk(first, last, 1);
+}
+
+/*
+ * Inserts the values in [first, last) in one pass (see `insert_bulk`), rebuilding
+ * the affected suffix with up to `threads` threads.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename ForwardIterator>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_insert_bulk(ForwardIterator first, ForwardIterator last, size_t threads){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::insert_bulk);
+    size_t batch = std::distance(first, last);
+    if(batch == 0){
+        return;
+    }
+    compact();
+    if(count + batch > storage){                                                                    // make room for the whole batch at once
+        if(fixed){
+            throw std::length_error("Maximum size exceeded for fixed-size container.");
+        }
+        _resize(std::max(count + batch, storage * 2));
+    }
+    std::vector<uint64_t> hashes;
+    for(auto i = first; filtering && i != last; ++i){
+        hashes.push_back(_filter_hash(*i));                                                         // (before the batch is moved in)
+    }
+    size_t min_index = count;
+    auto   i         = count;
+    try{
+        for(; first != last; ++first, ++i){                                                         // append the batch, keeping track of the
+            _construct(i, *first);                                                                  // location of its smallest value
+            if(comp(_slot(i), _slot(min_index))){
+                min_index = i;
+            }
+        }
+    }
+    catch(...){
+        _destroy(count, i);                                                                         // (a copy threw: the batch isn't inserted)
+        throw;
+    }
+    auto partition = _find_partition(_slot(min_index), true);                                         // every partition before the one the batch
+    _set_count(count + batch);                                                                      // minimum belongs in is already correct, so
+    _init_heaps(partition, threads);                                                                // only the remaining suffix is rebuilt
+    for(auto hash : hashes){
+        _filter_added(hash);
     }
-    auto partition = _find_partition(value, true);                                                  // find which partition the new value
-    bool done      = false;                                                                         // belongs in
-    do{                                                                                             // then add it to that partition, and
-        auto p_count = _count_in_partition(partition);                                              // "ripple" the maximum value (which
-        auto ripple  = heap_insert_circular(value,                                                  // will be displaced if the partition is
-                            a + _partition_start(partition),                                        // non-final and thus full)
-                            p_count,                                                                // down to subsequent partitons,
-                            _partition_size(partition));                                            // until the final partition is reached
-        done  = !ripple.first;
-        value = ripple.second;
-        ++partition;
-    }while(!done);
-    ++count;
 }
 
 /**
@@ -267,59 +1873,697 @@ void HeapArray<DataType>::insert(DataType value){
  * @param value  the value to remove
  * @return       true if `value` is removed, `false` otherwise
  */
-template <typename DataType>
-bool HeapArray<DataType>::remove(const DataType& value){
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+bool HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::remove(const DataType& value){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::remove);
     bool removed  = false;
+    if(filtering && !membership.maybe_contains(_filter_hash(value))){                                // (certainly absent)
+        return false;
+    }
     auto find_res = _find(value);
+    if(std::get<0>(find_res)){
+        _filter_removed(value);
+    }
+    if(std::get<0>(find_res) && head_valid && std::get<2>(find_res) == head_p){                     // in the partition `pop_min` is draining,
+        _pop_head(std::get<3>(find_res));                                                           // remove it from the heap, no ripple
+        stats.ripple(1);
+        return true;
+    }
+    if(std::get<0>(find_res) && lazy){                                                              // lazy mode: just mark the slot as dead
+        _mark_dead(std::get<1>(find_res));
+        if(dead_count > lazy_threshold * count){
+            compact();
+        }
+        stats.ripple(0);
+        return true;
+    }
+    if(std::get<0>(find_res) && dead_count > 0 && dead_last >= _partition_start(std::get<2>(find_res))){
+        compact();                                                                                  // the ripple would scramble dead slots
+        find_res = _find(value);                                                                    // (left by `pop_min`), so clear them out first
+    }
     if(std::get<0>(find_res)){
         auto partition = std::get<2>(find_res);
         if(partition == _final_partition()){                                                        // if the delete happens to be in the final
             size_t p_count = _count_in_partition(partition);                                        // partition, no "ripple" is necessary,
             heap_remove_at_index(                                                                   // and the element can be trivially
                 std::get<3>(find_res),                                                              // removed
-                a + _partition_start(partition), p_count);
+                _partition_data(partition), p_count, comp);
         }
         else{                                                                                       // non-trivial ripple delete, starting from the end:
             size_t p_count = _count_in_partition(_final_partition());
             auto ripple    = heap_remove_min(                                                       // ripple begins at right-most partition
-                                a + _partition_start(_final_partition()), p_count);
+                                _partition_data(_final_partition()), p_count, comp);
             for(auto p = _final_partition() - 1; p > partition; --p){
                 ripple = heap_replace_at_index(                                                     // ripples through intermediate partititions
-                    ripple,
+                    std::move(ripple),
                     0,
-                    a + _partition_start(p),
-                    _count_in_partition(p) );
+                    _partition_data(p),
+                    _count_in_partition(p),
+                    comp);
             }
             heap_replace_at_index(                                                                  // and replaces the victim in the destination
-                ripple,
+                std::move(ripple),
                 std::get<3>(find_res),
-                a + _partition_start(partition),
-                _count_in_partition(partition));
+                _partition_data(partition),
+                _count_in_partition(partition),
+                comp);
         }
+        stats.ripple(_final_partition() - partition + 1);
         removed = true;
-        --count;
+        _set_count(count - 1);
+        _destroy(count, count + 1);                                                                 // the slot vacated by the ripple
+        _update_bounds_from(partition);                                                             // every partition from the victim's on changed
     }
     return removed;
 }
 
+/**
+ * @brief   Remove a batch of elements from the HeapArray, given their values.
+ * @details Removes one instance of each value in the range [first, last) (so a value that
+ *          appears twice in the range removes two instances, if there are two).  Values that
+ *          are not present are ignored.  Rather than "rippling" once per removal, every
+ *          partition from the first one that could hold any of the values is checked once,
+ *          the victims are dropped, the tail is shifted across the holes in a single pass,
+ *          and only the partitions from the first hole onward are rebuilt.
+ *
+ * @param  first  iterator to the first value to remove
+ * @param  last   iterator to the position following the last value to remove
+ * @tparam ForwardIterator  an iterator type satisfying ForwardIterator, whose value
+ *                          type is `DataType`
+ * @return        the number of elements removed
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename ForwardIterator>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::remove_bulk(ForwardIterator first, ForwardIterator last){
+    return _remove_bulk(first, last, 1);
+}
+
+/*
+ * Removes one instance of each value in [first, last) in one pass (see `remove_bulk`),
+ * rebuilding the affected suffix with up to `threads` threads.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename ForwardIterator>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_remove_bulk(ForwardIterator first, ForwardIterator last, size_t threads){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::remove_bulk);
+    std::vector<DataType> values(first, last);
+    if(values.empty() || count == 0){
+        return 0;
+    }
+    std::sort(values.begin(), values.end(), comp);
+    std::vector<std::pair<DataType, size_t>> victims;                                              // distinct values, with the number of
+    for(auto& v : values){                                                                          // instances of each left to remove
+        if(victims.empty() || !equal(victims.back().first, v)){
+            victims.emplace_back(v, 0);
+        }
+        ++victims.back().second;
+    }
+    size_t remaining = values.size();
+    auto   is_victim = [this, &victims, &remaining](const DataType& value){
+        bool victim = false;
+        if(remaining > 0){
+            auto v = std::lower_bound(victims.begin(), victims.end(), value,
+                        [this](const std::pair<DataType, size_t>& lhs, const DataType& rhs){ return comp(lhs.first, rhs); });
+            if(v != victims.end() && equal(v->first, value) && v->second > 0){
+                --v->second;
+                --remaining;
+                victim = true;
+            }
+        }
+        return victim;
+    };
+    auto partition = _lower_bound_partition(victims.front().first);                                 // nothing that could match lives before this
+    return partition <= _final_partition() ? _erase_from(partition, is_victim, threads) : 0;
+}
+
+/**
+ * @brief   Remove every element for which a predicate holds.
+ * @details Checks each element once, drops those for which `pred` returns `true`, and
+ *          shifts the tail across the holes in a single pass.  Only the partitions
+ *          from the first hole onward are rebuilt.
+ *
+ * @param  pred  unary predicate taking a `const DataType&`; returns `true` for values to remove
+ * @tparam Predicate  a callable type satisfying the UnaryPredicate requirements
+ * @return       the number of elements removed
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename Predicate>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::erase_if(Predicate pred){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::erase_if);
+    return _erase_from(0, pred);
+}
+
+#if defined(__cpp_lib_execution)
+/**
+ * Insert a batch of new items (see `insert_bulk(first, last)`), rebuilding the affected
+ * partitions in parallel under a parallel execution policy.
+ *
+ * @param  policy  the execution policy
+ * @param  first   iterator to the first value to insert
+ * @param  last    iterator to the position following the last value to insert
+ * @tparam ExecutionPolicy  one of the standard execution policy types
+ * @throws std::length_error  if the batch doesn't fit and the container isn't allowed to resize
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename ExecutionPolicy, typename ForwardIterator>
+typename std::enable_if<std::is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value>::type
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::insert_bulk(ExecutionPolicy&&, ForwardIterator first, ForwardIterator last){
+    _insert_bulk(first, last, _heaparray::policy_threads<ExecutionPolicy>());
+}
+
+/**
+ * Remove a batch of elements (see `remove_bulk(first, last)`), rebuilding the affected
+ * partitions in parallel under a parallel execution policy (the scan for the victims
+ * is a single pass either way).
+ *
+ * @param  policy  the execution policy
+ * @param  first   iterator to the first value to remove
+ * @param  last    iterator to the position following the last value to remove
+ * @tparam ExecutionPolicy  one of the standard execution policy types
+ * @return the number of elements removed
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename ExecutionPolicy, typename ForwardIterator>
+typename std::enable_if<std::is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, size_t>::type
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::remove_bulk(ExecutionPolicy&&, ForwardIterator first, ForwardIterator last){
+    return _remove_bulk(first, last, _heaparray::policy_threads<ExecutionPolicy>());
+}
+
+/**
+ * Remove every element for which a predicate holds (see `erase_if(pred)`), rebuilding
+ * the affected partitions in parallel under a parallel execution policy (`pred` is
+ * still called from a single thread).
+ *
+ * @param  policy  the execution policy
+ * @param  pred    unary predicate taking a `const DataType&`; returns `true` for values to remove
+ * @tparam ExecutionPolicy  one of the standard execution policy types
+ * @return the number of elements removed
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename ExecutionPolicy, typename Predicate>
+typename std::enable_if<std::is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, size_t>::type
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::erase_if(ExecutionPolicy&&, Predicate pred){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::erase_if);
+    return _erase_from(0, pred, _heaparray::policy_threads<ExecutionPolicy>());
+}
+#endif
+
+/**
+ * @brief   Move every value of another HeapArray into this one.
+ * @details Both HeapArrays' partitions are already in range order, so the two are merged
+ *          run by run, as sorted lists would be, rather than being rebuilt from scratch:
+ *          the partitions of this HeapArray that hold only values smaller than `other`'s
+ *          minimum stay where they are, and the new partitions after them are filled one
+ *          at a time from a pool of the next partitions of each side (whichever side's
+ *          next partition has the smaller minimum joins first), so each value goes through
+ *          one selection about the size of a partition.  Costs about O(n_tail + m) for
+ *          `m` values merged in and the `n_tail` values of this HeapArray from their
+ *          minimum on, against O((n + m) lg(n + m)) for building a new HeapArray from the
+ *          values of both.  Both HeapArrays must order their values the same way.
+ *          Any dead slots (from lazy removal) on either side are dropped first.
+ *          If the values won't fit, the container grows unless it is fixed-size, in
+ *          which case nothing is merged and a std::length_error is thrown.
+ *
+ * @param  other  the HeapArray to merge in (left empty, with its storage released)
+ * @throws std::length_error  if the values don't fit and the container isn't allowed to resize
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::merge(HeapArray&& other){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::merge);
+    if(&other == this || other.size() == 0){
+        return;
+    }
+    compact();
+    other.compact();
+    auto total = count + other.count;
+    if(total > storage && fixed){
+        throw std::length_error("Maximum size exceeded for fixed-size container.");
+    }
+    std::vector<uint64_t> hashes;
+    for(size_t i = 0; filtering && i < other.count; ++i){
+        hashes.push_back(_filter_hash(other._slot(i)));                                             // (before the values are moved away)
+    }
+    head_valid = false;
+    auto first = _lower_bound_partition(other.min());                                               // every partition before this one holds
+    if(first > _final_partition() && count < _partition_start(first)){                              // only smaller values, and stays put
+        first = _final_partition();                                                                 // (but a partly full final partition is
+    }                                                                                               // filled up, so it is merged, too)
+    auto start = _partition_start(first);
+    std::vector<DataType> tail;
+    tail.reserve(count - std::min(start, count));
+    for(auto i = start; i < count; ++i){                                                            // the rest step aside, keeping their
+        tail.push_back(std::move(_slot(i)));                                                        // partitions as runs
+    }
+    std::vector<run> ours, theirs;
+    for(auto p = first; count > 0 && p <= _final_partition(); ++p){
+        auto offset = _partition_start(p) - start;
+        ours.emplace_back(tail.data() + offset, tail.data() + offset + _count_in_partition(p));
+    }
+    for(size_t p = 0; p <= other._final_partition(); ++p){
+        auto data = other._partition_data(p);
+        theirs.emplace_back(data, data + other._count_in_partition(p));
+    }
+    if(start < count){
+        _destroy(start, count);
+        _set_count(start);
+    }
+    if(total > storage){                                                                            // (only the values kept in place move)
+        _resize(std::max(total, storage * 2));
+    }
+    _append_runs(ours, theirs);
+    _update_bounds_from(first);
+    for(auto hash : hashes){
+        _filter_added(hash);
+    }
+    other._release();
+    other._set_count(0);
+    other.head_valid = false;
+    other.bounds.clear();
+    if(other.filtering){
+        other._rebuild_filter();
+    }
+}
+
+/**
+ * @brief   Split off every value not less than `value` into a new HeapArray.
+ * @details Partitions are ordered, so the cut runs through just one partition:  the
+ *          partitions before it are kept as they are and the ones after it move out
+ *          whole, and only the partition holding the cut is divided (it becomes the final
+ *          partition here, and is the only one rebuilt).  The values moved out are laid
+ *          into the new HeapArray's partitions run by run (see `merge`), with no
+ *          rebuild.  Costs O(lg(n) + sqrt(n) + n_moved).
+ *          The new HeapArray has the same ordering, options and allocator as this one;
+ *          if this one is fixed-size, so is the new one, with the same capacity.  Any
+ *          dead slots (from lazy removal) are dropped first.
+ *
+ * @param  value  the value to split at
+ * @return a HeapArray holding every value `v` with `value <= v` (which are removed from this one)
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats> HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::split_at(const DataType& value){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::split);
+    compact();
+    auto p = _lower_bound_partition(value);
+    if(count == 0 || p > _final_partition()){
+        return _split(p, 0);
+    }
+    auto data = _partition_data(p);
+    auto mid  = std::partition(data, data + _count_in_partition(p), [this, &value](const DataType& v){ return comp(v, value); });
+    return _split(p, mid - data);
+}
+
+/**
+ * @brief   Split off all but the `k` smallest values into a new HeapArray.
+ * @details With no dead slots a value's rank is its slot index (see `select`), so the
+ *          partition holding the cut is known without searching, and only it is divided,
+ *          by a selection; otherwise as `split_at`.  Costs O(sqrt(n) + n_moved).
+ *
+ * @param  k  the number of values to keep
+ * @return a HeapArray holding every value ranked `k` or above (which are removed from
+ *         this one); empty if `k >= size()`
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats> HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::split_at_rank(size_t k){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::split);
+    compact();
+    if(k >= count){
+        return _split(_final_partition() + 1, 0);
+    }
+    auto p    = _index_to_partition(k);                                                             // (with no dead slots, rank is slot index)
+    auto keep = k - _partition_start(p);
+    auto data = _partition_data(p);
+    if(keep > 0){
+        std::nth_element(data, data + keep, data + _count_in_partition(p), comp);
+    }
+    return _split(p, keep);
+}
+
 /**
  * Get the minimum value contained in the HeapArray
- * @return the minimum value in the container
+ * @return a reference to the minimum value in the container (valid until the HeapArray is next modified)
  */
-template <typename DataType>
-DataType  HeapArray<DataType>::min()const{
-    return a[0];                                                                                    // min is first element.
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+const DataType&  HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::min()const{
+    if(dead_count == 0 || !_is_dead(0)){
+        return _slot(0);                                                                            // min is first element.
+    }
+    if(head_valid){
+        return _slot(_partition_start(head_p));                                                     // (the root of the partition `pop_min` drains)
+    }
+    for(size_t p = 0; p < _final_partition(); ++p){                                                 // otherwise, it is the smallest live value
+        auto start = _partition_start(p);                                                           // in the first partition that has one (the
+        if(!_is_dead(start)){                                                                       // heap root, if it is live)
+            return _slot(start);
+        }
+        size_t m = start;
+        for(auto i = start + 1; i < start + _count_in_partition(p); ++i){
+            if(!_is_dead(i) && (_is_dead(m) || comp(_slot(i), _slot(m)))){
+                m = i;
+            }
+        }
+        if(!_is_dead(m)){
+            return _slot(m);
+        }
+    }
+    size_t m = _partition_start(_final_partition());
+    for(auto i = m; i < count; ++i){
+        if(!_is_dead(i) && (_is_dead(m) || comp(_slot(i), _slot(m)))){
+            m = i;
+        }
+    }
+    return _slot(m);
 }
 
 /**
  * Get the maximum value contained in the HeapArray
- * @return the maximum value in the container
+ * @return a reference to the maximum value in the container (valid until the HeapArray is next modified)
  */
-template <typename DataType>
-DataType  HeapArray<DataType>::max()const{
-    return heap_max(a +                                                                          // max is maximum element in
-        _partition_start(_final_partition()),                                                       // the final partition
-        _count_in_partition(_final_partition()));                                                   // (mmheap can access it in O(1))
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+const DataType&  HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::max()const{
+    if(dead_count == 0 || dead_last < _partition_start(_final_partition())){
+        return heap_max(                                                                            // max is maximum element in
+            _partition_data(_final_partition()),                                                    // the final partition
+            _count_in_partition(_final_partition()), comp);                                         // (mmheap can access it in O(1))
+    }
+    size_t m = 0;
+    for(auto p = _final_partition() + 1; p-- > 0; ){
+        auto start = _partition_start(p);                                                           // otherwise, it is the largest live value
+        m          = start;                                                                         // in the last partition that has one
+        for(auto i = start + 1; i < start + _count_in_partition(p); ++i){
+            if(!_is_dead(i) && (_is_dead(m) || comp(_slot(m), _slot(i)))){
+                m = i;
+            }
+        }
+        if(!_is_dead(m)){
+            break;
+        }
+    }
+    return _slot(m);
+}
+
+/**
+ * @brief   Remove and return the minimum value.
+ * @details Rather than "rippling" the whole array forward to refill the front, popping
+ *          drains the first partition with live values as a heap of its own:  the minimum
+ *          is removed from that partition's heap, and the slot this frees at the end of the
+ *          partition is marked dead (as in lazy removal).  Once the partition is empty, the
+ *          next one (already a heap) is drained in turn, and the partition search skips the
+ *          drained ones.  Inserts and removes that land in the partition being drained reuse
+ *          its slots, also without a ripple.  A pop costs O(lg(sqrt(n))), and the dead slots
+ *          are compacted away in one pass when their fraction passes the compaction threshold
+ *          (see `set_lazy_remove`), so the cost of compaction is amortized over the pops.
+ *
+ * @return  the minimum value
+ * @throws  std::out_of_range if the HeapArray is empty
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+DataType HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::pop_min(){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::pop_min);
+    if(size() == 0){
+        throw std::out_of_range("HeapArray is empty.");
+    }
+    if(!head_valid){                                                                                // start draining from the front, with any
+        compact();                                                                                  // other dead slots out of the way
+        head_valid = true;
+        head_p     = 0;
+        head_dead  = 0;
+    }
+    auto result = _pop_head(0);
+    _filter_removed(result);
+    return result;
+}
+
+/**
+ * @brief   Remove and return the maximum value.
+ * @details The maximum is removed from the final partition's heap; nothing else moves,
+ *          so a pop costs O(lg(sqrt(n))).
+ *
+ * @return  the maximum value
+ * @throws  std::out_of_range if the HeapArray is empty
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+DataType HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::pop_max(){
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::pop_max);
+    if(size() == 0){
+        throw std::out_of_range("HeapArray is empty.");
+    }
+    if(dead_count > 0 && dead_last >= _partition_start(_final_partition())){                        // the final partition's heap has to be whole
+        compact();
+    }
+    size_t n      = _count_in_partition(_final_partition());
+    auto   result = heap_remove_max(_partition_data(_final_partition()), n, comp);
+    _set_count(count - 1);
+    _destroy(count, count + 1);                                                                     // the slot vacated at the end
+    _update_bounds_from(_final_partition());
+    if(count > 0 && size() == 0){                                                                   // (only values `pop_min` left dead remain)
+        compact();
+    }
+    _filter_removed(result);
+    return result;
+}
+
+/**
+ * @brief   Copy the `k` smallest values, in ascending order.
+ * @details Only the first partitions holding `k` live values are read (since partitions
+ *          are ordered, the `k` smallest values are among them), and only the last of those
+ *          has to be partially sorted.  Costs about O(k lg(k)).
+ *
+ * @param  k    the number of values wanted (all of them, if `k` >= `size()`)
+ * @param  out  the output iterator to write the values to
+ * @tparam OutputIterator  an iterator type satisfying OutputIterator for `DataType`
+ * @return the output iterator past the last value written
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename OutputIterator>
+OutputIterator HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::top_k_smallest(size_t k, OutputIterator out)const{
+    std::vector<DataType> values;
+    k = std::min(k, size());
+    for(size_t p = head_valid ? head_p : 0; values.size() < k; ++p){                                // (partitions before `head_p` are all dead)
+        auto start = _partition_start(p);
+        for(auto i = start; i < start + _count_in_partition(p); ++i){
+            if(!_is_dead(i)){
+                values.push_back(_slot(i));
+            }
+        }
+    }
+    std::partial_sort(values.begin(), values.begin() + k, values.end(), comp);
+    return std::copy(values.begin(), values.begin() + k, out);
+}
+
+/**
+ * @brief   Copy the `k` largest values, in descending order.
+ * @details Only the last partitions holding `k` live values are read (see
+ *          `top_k_smallest`).  Costs about O(k lg(k)).
+ *
+ * @param  k    the number of values wanted (all of them, if `k` >= `size()`)
+ * @param  out  the output iterator to write the values to
+ * @tparam OutputIterator  an iterator type satisfying OutputIterator for `DataType`
+ * @return the output iterator past the last value written
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename OutputIterator>
+OutputIterator HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::top_k_largest(size_t k, OutputIterator out)const{
+    std::vector<DataType> values;
+    k = std::min(k, size());
+    for(auto p = _final_partition() + 1; values.size() < k && p-- > 0; ){
+        auto start = _partition_start(p);
+        for(auto i = start; i < start + _count_in_partition(p); ++i){
+            if(!_is_dead(i)){
+                values.push_back(_slot(i));
+            }
+        }
+    }
+    std::partial_sort(values.begin(), values.begin() + k, values.end(),
+                      [this](const DataType& lhs, const DataType& rhs){ return comp(rhs, lhs); });
+    return std::copy(values.begin(), values.begin() + k, out);
+}
+
+/**
+ * @brief   Count the values in the closed range [lo, hi].
+ * @details Partitions are ordered, so the values in range fill a run of consecutive
+ *          partitions, found by two binary searches over the partition bounds.  Every
+ *          partition strictly inside the run is counted whole; only the first and last
+ *          are scanned.  Costs O(lg(n) + sqrt(n)).
+ *
+ * @param  lo  the smallest value to count
+ * @param  hi  the largest value to count
+ * @return the number of values `v` with `lo <= v <= hi`
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::count_range(const DataType& lo, const DataType& hi)const{
+    size_t total = 0;
+    auto   first = _lower_bound_partition(lo);
+    auto   last  = _upper_bound_partition(hi);                                                      // (one past the final partition in range)
+    for(auto p = first; p < last; ++p){
+        if(p > first && p + 1 < last){
+            total += _live_in_partition(p);
+            continue;
+        }
+        auto start = _partition_start(p);
+        for(auto i = start; i < start + _count_in_partition(p); ++i){
+            total += !_is_dead(i) && !comp(_slot(i), lo) && !comp(hi, _slot(i)) ? 1 : 0;
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief   Call a function on every value in the closed range [lo, hi].
+ * @details Visits the run of partitions holding the range (see `count_range`), in
+ *          partition order:  values in different partitions are visited in ascending
+ *          order, but the values within one partition are visited in heap order.  Only
+ *          the first and last partitions of the run are filtered.  Use
+ *          `ordered_lower_bound` for a fully ascending walk.
+ *
+ * @param  lo  the smallest value to visit
+ * @param  hi  the largest value to visit
+ * @param  f   the function to call, as `f(value)`, with a `const DataType&`
+ * @tparam Function  a callable type taking a `const DataType&`
+ * @return `f`, as `std::for_each` does
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename Function>
+Function HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::for_each_in_range(const DataType& lo, const DataType& hi, Function f)const{
+    auto first = _lower_bound_partition(lo);
+    auto last  = _upper_bound_partition(hi);
+    for(auto p = first; p < last; ++p){
+        bool boundary = p == first || p + 1 == last;
+        auto start    = _partition_start(p);
+        for(auto i = start; i < start + _count_in_partition(p); ++i){
+            if(!_is_dead(i) && (!boundary || (!comp(_slot(i), lo) && !comp(hi, _slot(i))))){
+                f(_slot(i));
+            }
+        }
+    }
+    return f;
+}
+
+/**
+ * @brief   Count the values less than `value`.
+ * @details Every value in the partitions before the one `value` would be found in is
+ *          smaller, and none after it is, so only that one partition is scanned.  Costs
+ *          O(lg(n) + sqrt(n)).
+ *
+ * @param  value  the value to rank
+ * @return the number of values less than `value` (its index, counting from 0, in an
+ *         ascending ordering, or where it would be inserted)
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::rank(const DataType& value)const{
+    auto p     = _lower_bound_partition(value);
+    auto total = _live_before(p);
+    if(count > 0 && p <= _final_partition()){
+        auto start = _partition_start(p);
+        for(auto i = start; i < start + _count_in_partition(p); ++i){
+            total += !_is_dead(i) && comp(_slot(i), value) ? 1 : 0;
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief   Get the `k`th smallest value (counting from 0).
+ * @details Partition `p` always holds the values ranked from `Geometry::start(p)` to
+ *          `Geometry::start(p) + Geometry::size(p) - 1` (less any dead slots before it),
+ *          so the partition holding rank `k` is known without looking, and only that
+ *          partition is searched, by a partial sort of a copy of it.  Costs O(sqrt(n)).
+ *
+ * @param  k  the rank of the value wanted
+ * @return a copy of the value with `k` values before it in an ascending ordering
+ * @throws std::out_of_range if `k` >= `size()`
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+DataType HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::select(size_t k)const{
+    if(k >= size()){
+        throw std::out_of_range("Index out of range.");
+    }
+    auto p = _select_partition(k);
+    k     -= _live_before(p);
+    std::vector<DataType> values;
+    auto start = _partition_start(p);
+    for(auto i = start; i < start + _count_in_partition(p); ++i){
+        if(!_is_dead(i)){
+            values.push_back(_slot(i));
+        }
+    }
+    std::nth_element(values.begin(), values.begin() + k, values.end(), comp);
+    return values[k];
+}
+
+/**
+ * Get the median value (the lower of the two middle values, if `size()` is even);
+ * see `select`.
+ *
+ * @return a copy of the median value
+ * @throws std::out_of_range if the HeapArray is empty
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+DataType HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::median()const{
+    if(size() == 0){
+        throw std::out_of_range("HeapArray is empty.");
+    }
+    return select((size() - 1) / 2);
+}
+
+/**
+ * @brief   Get bounds on the `q` quantile, without searching.
+ * @details Returns the minimum and maximum of the partition holding the value of rank
+ *          `q * (size() - 1)`; the quantile lies between them.  The partition is found by
+ *          arithmetic on its rank and its bounds are read from the bounds cache, so this
+ *          costs O(1) (unless there are removed values still to compact; see `select`).
+ *          The partitions hold O(sqrt(n)) values, so the bounds are within about
+ *          `2 / sqrt(n)` of `q` in rank:  for large n, a close estimate of a percentile.
+ *
+ * @param  q  the quantile wanted, from 0 (the minimum) to 1 (the maximum)
+ * @return a pair of references to the bounds (valid until the HeapArray is next modified)
+ * @throws std::out_of_range if the HeapArray is empty, or `q` is not in [0, 1]
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+std::pair<const DataType&, const DataType&>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::approx_quantile(double q)const{
+    if(size() == 0){
+        throw std::out_of_range("HeapArray is empty.");
+    }
+    if(!(q >= 0.0 && q <= 1.0)){
+        throw std::out_of_range("Quantile out of range.");
+    }
+    auto k = std::min(static_cast<size_t>(q * static_cast<double>(size() - 1)), size() - 1);
+    return _range_in_partition(_select_partition(k));
+}
+
+/**
+ * Get an iterator to the smallest value, for a walk over the values in ascending
+ * order (see `ordered_iterator`).
+ *
+ * @return the iterator
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+typename HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::ordered_iterator
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::ordered_begin()const{
+    return ordered_iterator(this, _first_live_partition(), nullptr);
+}
+
+/**
+ * Get an iterator to the first value, in ascending order, that is not less than
+ * `value` (see `ordered_iterator`); finding it costs O(lg(n) + sqrt(n)).
+ *
+ * @param  value  the value to search for
+ * @return the iterator (equal to `ordered_end()` if every value is less than `value`)
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+typename HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::ordered_iterator
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::ordered_lower_bound(const DataType& value)const{
+    return ordered_iterator(this, _lower_bound_partition(value), &value);
+}
+
+/**
+ * Get the past-the-end iterator of an ascending walk.
+ * @return the iterator
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+typename HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::ordered_iterator
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::ordered_end()const{
+    return ordered_iterator();
 }
 
 /**
@@ -333,8 +2577,12 @@ DataType  HeapArray<DataType>::max()const{
  *               found (false otherwise) and the `second` attribute is the index
  *               at which `value` was located (only if it was found).
  */
-template <typename DataType>
-std::pair<bool, size_t>  HeapArray<DataType>::find(const DataType& value)const{
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+std::pair<bool, size_t>  HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::find(const DataType& value)const{
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::find);
+    if(filtering && !membership.maybe_contains(_filter_hash(value))){                                // (certainly absent)
+        return {false, 0};
+    }
     auto t_res = _find(value);
     std::pair<bool, size_t> result{std::get<0>(t_res), std::get<1>(t_res)};
     return result;
@@ -346,62 +2594,515 @@ std::pair<bool, size_t>  HeapArray<DataType>::find(const DataType& value)const{
  * @param value  the value to search for
  * @return       true if `value` is found, false otherwise
  */
-template <typename DataType>
-bool HeapArray<DataType>::contains(const DataType& value)const{
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+bool HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::contains(const DataType& value)const{
     return count > 0 ? find(value).first : false;
 }
 
+/**
+ * @brief   Find the locations of a batch of values.
+ * @details Gives the same answers as calling `find` on each key, but searches the keys
+ *          in groups of FIND_GROUP_SIZE, in lockstep: each step of the binary search
+ *          over the partitions is taken for every key in the group before the next, with
+ *          each key's next probe prefetched, and then each key's partition is prefetched
+ *          before any of them is scanned.  The cache misses of the keys in a group
+ *          overlap instead of being paid one after another.
+ *
+ * @param keys     pointer to the first of the `k` values to search for
+ * @param k        the number of values to search for
+ * @param results  pointer to space for `k` results; `results[i]` is set to what
+ *                 `find(keys[i])` would return
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::find_many(const DataType* keys, size_t k, std::pair<bool, size_t>* results)const{
+    _find_group(keys, k, [results](size_t i, bool found, size_t index){
+        results[i] = std::pair<bool, size_t>{found, index};
+    });
+}
+
+/**
+ * Determine which of a batch of values the HeapArray contains (see `find_many`).
+ *
+ * @param keys     pointer to the first of the `k` values to search for
+ * @param k        the number of values to search for
+ * @param results  pointer to space for `k` flags; `results[i]` is set to `contains(keys[i])`
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::contains_many(const DataType* keys, size_t k, bool* results)const{
+    _find_group(keys, k, [results](size_t i, bool found, size_t){
+        results[i] = found;
+    });
+}
+
+/*
+ * Get the address of the first slot of the partition whose partition-index is `p`
+ * (each partition's slots are contiguous, whatever the storage policy).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline DataType* HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_partition_data(size_t p)const{
+    if constexpr(segmented){
+        return directory[p];
+    }
+    else{
+        return a + _partition_start(p);
+    }
+}
+
+/*
+ * Get the address of slot `i` (which may not hold a constructed value).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline DataType* HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_address(size_t i)const{
+    if constexpr(segmented){
+        auto p = _index_to_partition(i);
+        return directory[p] + (i - _partition_start(p));
+    }
+    else{
+        return a + i;
+    }
+}
+
+/*
+ * Get the value in slot `i`.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline DataType& HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_slot(size_t i)const{
+    return *_address(i);
+}
+
+/*
+ * Get a random-access iterator to slot `i`, for algorithms that work across
+ * partitions (a plain pointer in contiguous storage).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline auto HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_slot_iterator(size_t i)const{
+    if constexpr(segmented){
+        return _heaparray::segmented_iterator<DataType, Geometry>(directory.data(), i);
+    }
+    else{
+        return a + i;
+    }
+}
+
+/*
+ * Allocates (uninitialized) storage for `slots` values; the HeapArray must not
+ * have any storage yet.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_allocate(size_t slots){
+    if(slots > 0){
+        if constexpr(segmented){
+            _add_segment(_index_to_partition(slots - 1) + 1);
+        }
+        else{
+            a = alloc_traits::allocate(alloc, slots);
+        }
+    }
+    storage = slots;
+}
+
+/*
+ * Adds a segment holding the next `partitions` partitions to the directory
+ * (segmented storage only); existing segments are untouched.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_add_segment(size_t partitions){
+    auto first = directory.size();
+    auto slots = _partition_start(first + partitions) - _partition_start(first);
+    auto block = alloc_traits::allocate(alloc, slots);
+    segments.emplace_back(block, slots);
+    for(auto p = first; p < first + partitions; ++p){
+        directory.push_back(block + (_partition_start(p) - _partition_start(first)));
+    }
+}
+
+/*
+ * Constructs a value in the (uninitialized) slot `i` from `args`, via the allocator.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename... Args>
+inline void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_construct(size_t i, Args&&... args){
+    alloc_traits::construct(alloc, _address(i), std::forward<Args>(args)...);
+}
+
+/*
+ * Copies everything but the storage and the values from `rhs`: the options, the
+ * dead-slot state, the bounds cache, the membership filter and the function objects.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_copy_settings(const HeapArray& rhs){
+    fixed          = rhs.fixed;
+    lazy           = rhs.lazy;
+    lazy_threshold = rhs.lazy_threshold;
+    dead_count     = rhs.dead_count;
+    dead_first     = rhs.dead_first;
+    dead_last      = rhs.dead_last;
+    tombstones     = rhs.tombstones;
+    head_valid     = rhs.head_valid;
+    head_p         = rhs.head_p;
+    head_dead      = rhs.head_dead;
+    cache_bounds   = rhs.cache_bounds;
+    bounds         = rhs.bounds;
+    filtering      = rhs.filtering;
+    membership     = rhs.membership;
+    comp           = rhs.comp;
+    equal          = rhs.equal;
+}
+
+/*
+ * Copies the values of `rhs` into this HeapArray's (allocated, empty) storage, slot
+ * for slot, so they keep their layout; trivially copyable values are copied with
+ * `memcpy`, all at once in contiguous storage or a partition at a time in segmented.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_copy_values(const HeapArray& rhs){
+    final_p = rhs.final_p;
+    if constexpr(std::is_trivially_copyable<DataType>::value){
+        if(rhs.count > 0 && segmented){
+            for(size_t p = 0; p <= rhs._final_partition(); ++p){
+                std::memcpy(static_cast<void*>(_partition_data(p)), static_cast<const void*>(rhs._partition_data(p)),
+                            rhs._count_in_partition(p) * sizeof(DataType));
+            }
+        }
+        else if(rhs.count > 0){
+            std::memcpy(static_cast<void*>(a), static_cast<const void*>(rhs.a), rhs.count * sizeof(DataType));
+        }
+        count = rhs.count;
+    }
+    else{
+        for(count = 0; count < rhs.count; ++count){                                                 // (count tracks the constructed prefix)
+            _construct(count, rhs._slot(count));
+        }
+    }
+}
+
+/*
+ * Destroys the values in slots [first, last), leaving the slots uninitialized.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_destroy(size_t first, size_t last){
+    if(!std::is_trivially_destructible<DataType>::value){
+        for(auto i = first; i < last; ++i){
+            alloc_traits::destroy(alloc, _address(i));
+        }
+    }
+}
+
+/*
+ * Destroys every value and returns the storage to the allocator, leaving the
+ * HeapArray with no storage (and a count of zero).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_release(){
+    if(map_base){                                                                                   // a mapped image is left in its file
+        _unmap();
+    }
+    _destroy(0, count);
+    if(a){
+        alloc_traits::deallocate(alloc, a, storage);
+    }
+    for(auto& segment : segments){
+        alloc_traits::deallocate(alloc, segment.first, segment.second);
+    }
+    segments.clear();
+    directory.clear();
+    a       = nullptr;
+    storage = 0;
+    count   = 0;
+}
+
+/*
+ * Get the header of the mapped image (memory-mapped HeapArrays only).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline _heaparray::image_header* HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_image_header()const{
+    return static_cast<_heaparray::image_header*>(map_base);
+}
+
+/*
+ * Resizes the mapped image file to hold `slots` values and maps it again
+ * (memory-mapped HeapArrays only); the values stay in the file, so nothing is
+ * copied, but their address may change.
+ *     throws  std::runtime_error if the file can't be resized or mapped
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_remap(size_t slots){
+#if defined(HEAPARRAY_HAS_MMAP)
+    auto bytes = sizeof(_heaparray::image_header) + slots * sizeof(DataType);
+    if(bytes > map_bytes && ftruncate(map_fd, static_cast<off_t>(bytes)) != 0){
+        throw std::runtime_error("Cannot grow the HeapArray image file.");
+    }
+    auto base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, map_fd, 0);                // map the new size before letting go of
+    if(base == MAP_FAILED){                                                                         // the old mapping, so a failure leaves the
+        throw std::runtime_error("Cannot map the HeapArray image file.");                           // HeapArray as it was
+    }
+    munmap(map_base, map_bytes);                                                                    // (a shrunken image keeps its file size)
+    map_base  = base;
+    map_bytes = bytes;
+    a         = reinterpret_cast<DataType*>(static_cast<char*>(map_base) + sizeof(_heaparray::image_header));
+    storage   = slots;
+    _image_header()->storage = slots;
+#else
+    (void)slots;
+#endif
+}
+
+/*
+ * Writes the final state of a mapped image into its header (compacting away any
+ * lazily removed values first, since the tombstones aren't part of the image),
+ * then unmaps and closes the file.  The HeapArray is left with no storage.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_unmap(){
+#if defined(HEAPARRAY_HAS_MMAP)
+    compact();
+    _image_header()->count = count;
+    munmap(map_base, map_bytes);
+    close(map_fd);
+#endif
+    map_fd    = -1;
+    map_base  = nullptr;
+    map_bytes = 0;
+    a         = nullptr;
+    storage   = 0;
+    count     = 0;
+}
+
+/*
+ * Writes the image of the HeapArray (header, then the values a partition at a time)
+ * through `sink(data, bytes)`.  Dead slots are left out by writing a compacted copy
+ * instead, so the HeapArray itself is never changed.
+ *     checksum  `true` to record a checksum of the values in the header
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename Sink>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_write_image(Sink sink, bool checksum)const{
+    static_assert(std::is_trivially_copyable<DataType>::value, "HeapArray images need a trivially copyable DataType.");
+    if(dead_count > 0){
+        auto live = clone(true);                                                                    // (drops the dead slots, unless
+        live.compact();                                                                             //  this is fixed-size)
+        live._write_image(sink, checksum);
+        return;
+    }
+    auto header = _heaparray::image_header::make<Geometry>(sizeof(DataType), count, count);
+    auto parts  = count > 0 ? _final_partition() + 1 : 0;
+    if(checksum){
+        header.checksum = _heaparray::FNV_OFFSET;
+        for(size_t p = 0; p < parts; ++p){
+            header.checksum = _heaparray::fnv1a(header.checksum, _partition_data(p), _count_in_partition(p) * sizeof(DataType));
+        }
+    }
+    sink(&header, sizeof(header));
+    for(size_t p = 0; p < parts; ++p){                                                              // (each partition is contiguous)
+        sink(_partition_data(p), _count_in_partition(p) * sizeof(DataType));
+    }
+}
+
+/*
+ * Replaces the contents of the HeapArray with an image read through `source(data, bytes)`
+ * (which returns `false` if it runs out), reading the values straight into new storage.
+ * A count that can't fit in the `available` bytes (header included) is rejected before
+ * the current contents are touched.
+ *     throws  std::runtime_error if the image is malformed, short, fails its checksum,
+ *             or needs more memory than can be had (the HeapArray is left empty), or
+ *             std::length_error if it won't fit in a fixed-size HeapArray
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename Source>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_read_image(Source source, size_t available){
+    static_assert(std::is_trivially_copyable<DataType>::value, "HeapArray images need a trivially copyable DataType.");
+    _heaparray::image_header header;
+    if(!source(&header, sizeof(header)) || !header.valid<Geometry>(sizeof(DataType))){
+        throw std::runtime_error("Not a HeapArray snapshot of this type.");
+    }
+    if(header.count > (available - sizeof(header)) / sizeof(DataType)){                             // (a bad or truncated header must not
+        throw std::runtime_error("HeapArray snapshot ends early.");                                 //  allocate before any value is read)
+    }
+    auto slots = fixed ? storage : header.count;
+    if(header.count > slots){
+        throw std::length_error("Maximum size exceeded for fixed-size container.");
+    }
+    if(!fixed && slots > 0){                                                                         // (whole partitions, as `_resize` would give)
+        slots = _partition_start(_index_to_partition(slots - 1) + 1);
+    }
+    _release();
+    dead_count = 0;                                                                                 // (the image has no dead slots)
+    tombstones.clear();
+    head_valid = false;
+    bounds.clear();
+    try{
+        _allocate(slots);
+    }
+    catch(const std::bad_alloc&){
+        throw std::runtime_error("Not enough memory for the HeapArray snapshot.");
+    }
+    _set_count(header.count);
+    auto parts = count > 0 ? _final_partition() + 1 : 0;
+    auto hash  = _heaparray::FNV_OFFSET;
+    for(size_t p = 0; p < parts; ++p){                                                              // the values go straight into the (raw)
+        auto bytes = _count_in_partition(p) * sizeof(DataType);                                     // storage, a partition at a time
+        if(!source(_partition_data(p), bytes)){
+            _set_count(0);
+            throw std::runtime_error("HeapArray snapshot ends early.");
+        }
+        hash = header.checksum ? _heaparray::fnv1a(hash, _partition_data(p), bytes) : 0;
+    }
+    if(header.checksum && hash != header.checksum){
+        _set_count(0);
+        throw std::runtime_error("HeapArray snapshot fails its checksum.");
+    }
+    _update_bounds_from(0);
+    if(filtering){
+        _rebuild_filter();
+    }
+}
+
+/*
+ * Fills the (empty) HeapArray with copies of the values in [begin, end) and builds
+ * the heaps with up to `threads` threads (the body of the array constructors).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_build(DataType* begin, DataType* end, DataType* physical_end, bool allow_resize,
+                                                                    size_t threads){
+    auto new_size = physical_end ? physical_end - begin : end - begin;
+    _resize(new_size, allow_resize);                                                                // get space (rounds up only if resize is allowed)
+    size_t i = 0;
+    try{
+        for(; begin + i != end; ++i){                                                               // copy in the existing range of values
+            _construct(i, begin[i]);
+        }
+    }
+    catch(...){                                                                                     // if a copy throws, the destructor won't
+        _destroy(0, i);                                                                             // run, so release the copies made so far
+        _release();                                                                                 // and the storage here
+        throw;
+    }
+    _set_count(end - begin);
+    _init_heaps(0, threads);                                                                        // and make-heap in each partition
+    fixed = !allow_resize;
+}
+
+/*
+ * turns an arbitrary array of values into the appropriate list-of-contiguous-heaps structure
+ *     first_partition  partition-index of the first partition to rebuild; all partitions
+ *                      before it must already be correct, and must contain no value greater
+ *                      than any value from `first_partition` onward (default=0, rebuild all)
+ *     threads          the number of threads that may share the work (default=1); each
+ *                      gets at least MIN_PARALLEL_SLOTS values
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_init_heaps(size_t first_partition, size_t threads){
+    auto first = _partition_start(first_partition);
+    if(count <= first){
+        _update_bounds_from(first_partition);
+        return;
+    }
+    threads = std::max(size_t{1}, std::min(threads, (count - first) / MIN_PARALLEL_SLOTS));
+    _select_partitions(first_partition, _final_partition() + 1, threads);
+    if(threads == 1){
+        _heapify_partitions(first_partition, _final_partition() + 1);
+    }
+    else{                                                                                           // heapify in groups of partitions that hold
+        std::vector<size_t> group(threads + 1, _final_partition() + 1);                            // about the same number of values each
+        for(size_t t = 0; t < threads; ++t){
+            group[t] = std::max(first_partition, _index_to_partition(first + (count - first) / threads * t));
+        }
+        _heaparray::parallel_for(threads, [&](size_t t){ _heapify_partitions(group[t], group[t + 1]); });
+    }
+    _update_bounds_from(first_partition);
+}
+
 /*
- * turns an arbitrary array of values into the appropriate list-of-contiguous-heaps structure
+ * heapifies each partition in [first_partition, last_partition), once they hold
+ * the right values
  */
-template <typename DataType>
-void HeapArray<DataType>::_init_heaps(){
-    std::sort(a, a+count);
-    for(size_t p = 1; p <= _final_partition(); ++p){                                                // first partition is trivially a heap.
-        make_heap(a + _partition_start(p), _count_in_partition(p));                                 // heapify the rest.
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_heapify_partitions(size_t first_partition, size_t last_partition){
+    for(size_t p = first_partition; p < last_partition; ++p){
+        mmheap::make_heap(_partition_data(p), _count_in_partition(p), comp);
     }
 }
 
+/*
+ * Moves each value in partitions [first_partition, last_partition) into the right
+ * partition (see `_heaparray::select_partitions`).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_select_partitions(size_t first_partition, size_t last_partition, size_t threads){
+    auto first = _partition_start(first_partition);
+    _heaparray::select_partitions<Geometry>(_slot_iterator(first), first, count, first_partition, last_partition, comp, threads);
+}
+
 /*
  * resizes the underlying array container
  *     new_size  new size of the physical container
- *     round_up  set to `true` to round size up to the next perfect square (default=true)
+ *     round_up  set to `true` to round size up to the end of a partition (default=true)
  *     throws    std::runtime_error if the HeapArray is set to "fixed" size mode
  */
-template <typename DataType>
-void HeapArray<DataType>::_resize(size_t new_size, bool round_up){
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_resize(size_t new_size, bool round_up){
     if(fixed){
         throw std::runtime_error("Resize disabled for this array.");
     }
+    if constexpr(segmented){
+        if(new_size > 0){                                                                           // add a segment for any partitions that
+            auto partitions = _index_to_partition(new_size - 1) + 1;                                // aren't allocated yet; nothing moves
+            if(partitions > directory.size()){
+                _add_segment(partitions - directory.size());
+            }
+            if(count > new_size){
+                _destroy(new_size, count);
+                _set_count(new_size);
+            }
+            storage = round_up ? _partition_start(partitions) : new_size;
+            stats.resize(0);                                                                        // (nothing is copied)
+            return;
+        }
+    }
     if(new_size > 0){
-        // Allocation sizes should always be perfect squares.
+        // Allocation sizes should always end on a partition boundary.
         if(round_up){                                                                               // Round up unless told not to.
-            auto rt  = static_cast<size_t>(ceil(sqrt(new_size)));
-            new_size = static_cast<size_t>(rt*rt);
+            new_size = _partition_start(_index_to_partition(new_size - 1) + 1);
         }
-        DataType* victim = a;
-        a           = new DataType[new_size];
-        if(victim){
-            std::copy(victim, victim + std::min(count, new_size), a);                               // copy existing values (as many as will fit if sizing down)
+        if(map_base){                                                                               // a mapped image grows (or shrinks) in place
+            if(count > new_size){                                                                   // in its file
+                _set_count(new_size);
+            }
+            _remap(new_size);
+            stats.resize(0);
+            return;
         }
-        delete [] victim;
+        auto fresh = alloc_traits::allocate(alloc, new_size);
+        auto keep  = std::min(count, new_size);
+        for(size_t i = 0; i < keep; ++i){                                                           // move existing values (as many as will fit
+            alloc_traits::construct(alloc, fresh + i, std::move_if_noexcept(a[i]));                 // if sizing down), unless a throwing move
+        }                                                                                           // could lose some of them part-way
+        _destroy(0, count);                                                                         // then release the old storage
+        if(a){
+            alloc_traits::deallocate(alloc, a, storage);
+        }
+        a       = fresh;
         storage = new_size;
+        stats.resize(keep * sizeof(DataType));
+        if(keep < count){
+            _set_count(keep);
+        }
     }
     else{                                                                                           // size to zero to clear
-        count = storage = 0;
-        delete [] a;
-        a = nullptr;
+        _release();
+        _set_count(0);
+        bounds.clear();
     }
 }
 
 /*
  * Increases the size of the HeapArray to the next incremental size,
  * by doubling the current physical allocation (rounded up to the next
- * perfect square).
+ * partition boundary).
  */
-template <typename DataType>
-void HeapArray<DataType>::_grow(){
-    size_t  next_size = storage * 2;                                                                // double (and then round to next perfect square)
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_grow(){
+    size_t  next_size = storage * 2;                                                                // double (and then round to the next partition boundary)
     if(next_size == 0){                                                                             // or set to a minimum size if the container is new
         next_size = MIN_HEAPARRAY_ALLOCATION;
     }
@@ -411,44 +3112,63 @@ void HeapArray<DataType>::_grow(){
 /*
  * Get the partition-index of the final partition in the HeapArray
  */
-template <typename DataType>
-inline size_t HeapArray<DataType>::_final_partition()const{
-    return count > 0 ? static_cast<size_t>(ceil(sqrt(count)) - 1) : 0;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_final_partition()const{
+    return final_p;
+}
+
+/*
+ * Set the number of values in the HeapArray to `new_count`, and update the
+ * cached final partition-index to match (incrementally if the count only moved
+ * by one, otherwise from the partition holding the last value).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_set_count(size_t new_count){
+    if(new_count == count + 1){
+        final_p += new_count > _partition_start(final_p + 1) ? 1 : 0;                               // spilled into a new partition
+    }
+    else if(new_count + 1 == count){
+        final_p -= final_p > 0 && new_count <= _partition_start(final_p) ? 1 : 0;                   // emptied the final partition
+    }
+    else{
+        final_p = new_count > 0 ? _index_to_partition(new_count - 1) : 0;
+    }
+    count = new_count;
 }
 
 /*
  * Get the size of the partition given by the partition-index `p`.
  */
-template <typename DataType>
-inline size_t HeapArray<DataType>::_partition_size(size_t p)const{
-    return p * 2 + 1;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_partition_size(size_t p)const{
+    return Geometry::size(p);
 }
 
 /*
  * Get the array index of the first element contained in the partition whose
  * partition-index is `p`.
  */
-template <typename DataType>
-inline size_t HeapArray<DataType>::_partition_start(size_t p)const{
-    return p * p;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_partition_start(size_t p)const{
+    return Geometry::start(p);
 }
 
 /*
  * Get the array index of the last element contained in the partition whose
  * partition-index is `p`.
  */
-template <typename DataType>
-inline size_t HeapArray<DataType>::_partition_end(size_t p)const{
-    return p * p + p * 2;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_partition_end(size_t p)const{
+    return Geometry::start(p) + Geometry::size(p) - 1;
 }
 
 /*
  * Convert an array index to a partition-index (i.e. determine which partition
  * a particular array index falls within).
  */
-template <typename DataType>
-inline size_t HeapArray<DataType>::_index_to_partition(size_t i)const{
-    return i > 0 ? static_cast<size_t>(floor(sqrt(i))) : 0;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_index_to_partition(size_t i)const{
+    return Geometry::partition_of(i);
 }
 
 /*
@@ -456,11 +3176,11 @@ inline size_t HeapArray<DataType>::_index_to_partition(size_t i)const{
  * partition-index is `p`.
  * NOTE:  All partitions except the final one are always completely full.
  */
-template <typename DataType>
-size_t HeapArray<DataType>::_count_in_partition(size_t p)const{
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_count_in_partition(size_t p)const{
     auto c = _partition_size(p);                                                                    // prior partitions are always full.
     if(p >= _final_partition()){                                                                    // final partition may be less than full, find out:
-        c = count - (p * p);                                                                        // number in whole structure - number in partitions prior to this one
+        c = count - _partition_start(p);                                                            // number in whole structure - number in partitions prior to this one
     }
     return c;
 }
@@ -468,22 +3188,116 @@ size_t HeapArray<DataType>::_count_in_partition(size_t p)const{
 /*
  * Get the minimum and maximum values contained in the partition whose
  * partition-index is `p`.
+ * NOTE:  Dead slots (from lazy removal) are included; their values still bracket the
+ *        live values in the partition, so the partition search remains correct.  (The
+ *        dead tail of the partition `pop_min` is draining is not part of its heap, and
+ *        is left out.)
  */
-template <typename DataType>
-std::pair<DataType,DataType> HeapArray<DataType>::_range_in_partition(size_t p)const{
-    auto start_index = _partition_start(p);
-    auto p_min       = a[start_index];
-    auto p_max       = heap_max(a+start_index, _count_in_partition(p));
-    return std::pair<DataType,DataType>{p_min, p_max};
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+std::pair<const DataType&, const DataType&> HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_range_in_partition(size_t p)const{
+    if(cache_bounds){
+        return {bounds[p].first, bounds[p].second};
+    }
+    auto data = _partition_data(p);
+    return {data[0], heap_max(data, _heap_count(p), comp)};                                         // (by reference: no copies of the bounds)
 }
 
 /*
  * Get the maximum value contained in the partition whose partition-index is `p`.
  */
-template <typename DataType>
-DataType HeapArray<DataType>::_max_in_partition(size_t p)const{
-    auto start_index = _partition_start(p);
-    return heap_max(a+start_index, _count_in_partition(p));
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+const DataType& HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_max_in_partition(size_t p)const{
+    if(cache_bounds){
+        return bounds[p].second;
+    }
+    return heap_max(_partition_data(p), _heap_count(p), comp);
+}
+
+/*
+ * Refresh the cached bounds (if enabled) of the partition whose partition-index
+ * is `p`, which currently holds `p_count` values.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_update_bounds(size_t p, size_t p_count){
+    if(cache_bounds){
+        if(bounds.size() <= p){
+            bounds.resize(p + 1);
+        }
+        auto data        = _partition_data(p);
+        bounds[p].first  = data[0];
+        bounds[p].second = heap_max(data, head_valid && p == head_p ? p_count - head_dead : p_count, comp);
+    }
+}
+
+/*
+ * Refresh the cached bounds (if enabled) of every partition from the one whose
+ * partition-index is `first_partition` to the final partition, and drop any
+ * entries for partitions past the final one.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_update_bounds_from(size_t first_partition){
+    if(cache_bounds){
+        auto partitions = count > 0 ? _final_partition() + 1 : 0;
+        bounds.resize(partitions);
+        for(auto p = first_partition; p < partitions; ++p){
+            _update_bounds(p, _count_in_partition(p));
+        }
+    }
+}
+
+/*
+ * The (mixed) hash of `value` the membership filter uses (0 if `DataType` has no
+ * `std::hash`, in which case the filter can't be enabled).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline uint64_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_filter_hash(const DataType& value)const{
+    if constexpr(_heaparray::is_hashable<DataType>::value){
+        return _heaparray::mix_hash(std::hash<DataType>{}(value));
+    }
+    else{
+        (void)value;
+        return 0;
+    }
+}
+
+/*
+ * Records a value with hash `hash`, already inserted, in the membership filter (if
+ * enabled); rebuilds the filter at twice the size once it holds more values than it
+ * was sized for.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_filter_added(uint64_t hash){
+    if(filtering){
+        if(size() > membership.capacity()){
+            _rebuild_filter();
+        }
+        else{
+            membership.add(hash);
+        }
+    }
+}
+
+/*
+ * Drops a removed value from the membership filter (if enabled).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_filter_removed(const DataType& value){
+    if(filtering){
+        membership.drop(_filter_hash(value));
+    }
+}
+
+/*
+ * Rebuilds the membership filter from the live values, sized for twice as many.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_rebuild_filter(){
+    membership.reset(std::max(size(), size_t{32}) * 2);
+    for(size_t i = 0; i < count; ++i){
+        if(!_is_dead(i)){
+            membership.add(_filter_hash(_slot(i)));
+        }
+    }
 }
 
 /*
@@ -498,22 +3312,602 @@ DataType HeapArray<DataType>::_max_in_partition(size_t p)const{
  *
  *     value    the value to find
  */
-template <typename DataType>
-std::tuple<bool, size_t, size_t, size_t> HeapArray<DataType>::_find(const DataType& value)const{
-    auto   p     = _find_partition(value);
-    size_t index = 0;
-    bool   found = false;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+std::tuple<bool, size_t, size_t, size_t> HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_find(const DataType& value)const{
+    return _find_in(value, _find_partition(value));
+}
+
+/*
+ * Does the work of `_find` once the partition search is done:  `p` is the partition
+ * `_find_partition(value)` chose.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+std::tuple<bool, size_t, size_t, size_t> HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_find_in(const DataType& value, size_t p)const{
+    size_t index   = 0;
+    size_t scanned = 0;
+    bool   found   = false;
+    auto   scan    = [this, &value, &index, &scanned](size_t q){
+        auto start = _partition_start(q);
+        auto data  = _partition_data(q);
+        auto n     = _count_in_partition(q);                                                        // don't read stale slots past the final value
+        for(auto i = _heaparray::find_equal(data, n, value, equal); i < n;                          // (vectorized for arithmetic types)
+                 i += 1 + _heaparray::find_equal(data + i + 1, n - i - 1, value, equal)){
+            if(!_is_dead(start + i)){
+                index    = start + i;
+                scanned += i + 1;
+                return true;
+            }
+        }
+        scanned += n;
+        return false;
+    };
     if(count > 0){
-        for(auto i = _partition_start(p); !found && i <= _partition_end(p); ++i){
-            if(a[i] == value){
-                found = true;
-                index = i;
+        found = scan(p);
+        if(!found && dead_count > 0 && !comp(value, *_partition_data(p))                            // if `value` is in the range of `p`, its
+                                    && !comp(_max_in_partition(p), value)){                         // duplicates can straddle a partition
+            for(auto q = p; !found && q > _first_live_partition() && !comp(_max_in_partition(q-1), value); --q){
+                found = scan(q-1);                                                                  // boundary, and the ones found so far may be
+                p     = found ? q-1 : p;                                                            // dead, so check the neighbors too
+            }
+            for(auto q = p; !found && q < _final_partition() && !comp(value, *_partition_data(q+1)); ++q){
+                found = scan(q+1);
+                p     = found ? q+1 : p;
             }
         }
+        stats.scan(scanned);
     }
     return std::make_tuple(found, index, p, index - _partition_start(p));
 }
 
+/*
+ * Determine whether or not the slot at array index `i` is dead (lazily removed).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline bool HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_is_dead(size_t i)const{
+    return dead_count > 0 && i / 64 < tombstones.size() && (tombstones[i / 64] >> (i % 64) & 1);
+}
+
+/*
+ * Get the partition-index of the first partition that may hold live values:  the
+ * one `pop_min` is draining, if any (the partitions before it are all dead).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_first_live_partition()const{
+    return head_valid ? head_p : 0;
+}
+
+/*
+ * Get the number of values in the heap of the partition whose partition-index is
+ * `p`: all of its values, except in the partition `pop_min` is draining, whose dead
+ * tail isn't part of its heap.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_heap_count(size_t p)const{
+    auto c = _count_in_partition(p);
+    return head_valid && p == head_p ? c - head_dead : c;
+}
+
+/*
+ * Removes the value at offset `offset` in the heap of the partition `pop_min` is
+ * draining and returns it:  the slot freed at the end of the heap is marked dead,
+ * and once the heap is empty the next partition becomes the one being drained.
+ * Compacts when the dead fraction passes the threshold (or nothing live is left).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+DataType HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_pop_head(size_t offset){
+    auto   start  = _partition_start(head_p);
+    size_t n      = _heap_count(head_p);
+    auto   result = heap_remove_at_index(offset, _partition_data(head_p), n, comp);
+    _mark_dead(start + n);
+    head_valid = true;                                                                              // (`_mark_dead` cleared it)
+    ++head_dead;
+    if(n > 0){
+        _update_bounds(head_p, _count_in_partition(head_p));
+    }
+    else if(head_p < _final_partition()){                                                           // drained: move to the next partition,
+        ++head_p;                                                                                   // unless lazy removal left dead slots in
+        head_dead = 0;                                                                              // its heap (then the next pop compacts)
+        for(auto i = _partition_start(head_p); head_valid && i < _partition_start(head_p) + _count_in_partition(head_p); ++i){
+            head_valid = !_is_dead(i);
+        }
+    }
+    if(!head_valid || size() == 0 || dead_count > lazy_threshold * count){
+        compact();
+    }
+    return result;
+}
+
+/*
+ * Mark the slot at array index `i` as dead (lazily removed).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_mark_dead(size_t i){
+    if(tombstones.size() * 64 < count){
+        tombstones.resize((storage + 63) / 64, 0);
+    }
+    tombstones[i / 64] |= uint64_t{1} << (i % 64);
+    dead_first = dead_count > 0 ? std::min(dead_first, i) : i;
+    dead_last  = dead_count > 0 ? std::max(dead_last,  i) : i;
+    ++dead_count;
+    if(head_valid && _index_to_partition(i) <= head_p){
+        head_valid = false;                                                                         // (`pop_min` restores it for its own slots)
+    }
+}
+
+/*
+ * Mark the dead slot at array index `i` as live again (a value has been put in it),
+ * and narrow the range of dead slot indices if `i` was at either end of it.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_clear_dead(size_t i){
+    tombstones[i / 64] &= ~(uint64_t{1} << (i % 64));
+    if(--dead_count == 0){
+        return;
+    }
+    if(i == dead_first){                                                                            // (the next dead slot up)
+        auto w = i / 64;
+        while(tombstones[w] == 0){
+            ++w;
+        }
+        dead_first = w * 64 + _heaparray::lowest_bit(tombstones[w]);
+    }
+    if(i == dead_last){                                                                             // (the next dead slot down)
+        auto w = i / 64;
+        while(tombstones[w] == 0){
+            --w;
+        }
+        auto b = size_t{63};
+        while(!(tombstones[w] >> b & 1)){
+            --b;
+        }
+        dead_last = w * 64 + b;
+    }
+}
+
+/*
+ * Get the array index of the first dead slot in [first, last), or `last` if there is
+ * none.  Reads the tombstones a word (64 slots) at a time.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_next_dead(size_t first, size_t last)const{
+    if(dead_count == 0 || last <= dead_first || first > dead_last){
+        return last;
+    }
+    auto end = std::min(last, dead_last + 1);
+    for(auto i = std::max(first, dead_first); i < end; i = (i / 64 + 1) * 64){
+        auto word = tombstones[i / 64] >> (i % 64);
+        if(word != 0){
+            return std::min(i + _heaparray::lowest_bit(word), last);
+        }
+    }
+    return last;
+}
+
+/*
+ * Puts `value` (which belongs in the partition whose partition-index is `p`) into the
+ * dead slot at array index `i` of that partition.  Tombstones mark slots, not values,
+ * so the partition's heap can only be reordered around a single dead slot:  if it is
+ * the only one, the value just replaces it in the heap (O(lg(2p+1))).  Otherwise the
+ * partition is rebuilt (O(2p+1)) with its live values and `value` heaped at the front
+ * and the remaining dead slots after them, each holding a copy of its parent (which
+ * is always a valid leaf of a min-max heap).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_fill_dead(size_t p, size_t i, DataType&& value){
+    auto   start = _partition_start(p);
+    auto   data  = _partition_data(p);
+    size_t n     = _count_in_partition(p);
+    if(_next_dead(i + 1, start + n) == start + n){
+        heap_replace_at_index(std::move(value), i - start, data, n, comp);
+        _clear_dead(i);
+        return;
+    }
+    size_t live = 0;
+    for(size_t j = 0; j < n; ++j){                                                                  // gather the live values at the front
+        if(_is_dead(start + j)){
+            _clear_dead(start + j);
+        }
+        else{
+            if(live != j){
+                data[live] = std::move(data[j]);
+            }
+            ++live;
+        }
+    }
+    data[live++] = std::move(value);
+    make_heap(data, live, comp);
+    for(auto j = live; j < n; ++j){                                                                 // then the dead slots that are left
+        data[j] = data[_mmheap::parent(j)];
+        _mark_dead(start + j);
+    }
+}
+
+/*
+ * Removes every element (starting at the partition whose partition-index is
+ * `first_partition`) for which `is_victim` returns `true`, shifting the survivors
+ * down over the holes in one pass and rebuilding the partitions from the first
+ * hole onward.  `is_victim` is called exactly once per live element examined.
+ * Any dead slots (from lazy removal) are dropped in the same pass.
+ * Returns the number of (live) elements removed.
+ *     first_partition  partition-index of the first partition to examine
+ *     is_victim        unary predicate indicating which values to remove
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename Predicate>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_erase_from(size_t first_partition, Predicate is_victim_value, size_t threads){
+    auto   is_victim = [this, &is_victim_value](const DataType& value){
+        bool victim = is_victim_value(value);
+        if(victim){
+            _filter_removed(value);
+        }
+        return victim;
+    };
+    size_t write = _partition_start(first_partition);
+    if(dead_count > 0){
+        write = std::min(write, _partition_start(_index_to_partition(dead_first)));
+    }
+    while(write < count && !_is_dead(write) && !is_victim(_slot(write))){                               // survivors before the first hole stay put
+        ++write;
+    }
+    if(write >= count){
+        return 0;
+    }
+    size_t removed   = _is_dead(write) ? 0 : 1;
+    auto   partition = _index_to_partition(write);
+    for(auto read = write + 1; read < count; ++read){                                               // shift the tail across the holes
+        if(_is_dead(read)){
+            continue;
+        }
+        if(!is_victim(_slot(read))){
+            _slot(write++) = std::move(_slot(read));
+        }
+        else{
+            ++removed;
+        }
+    }
+    _destroy(write, count);
+    _set_count(write);
+    dead_count = 0;                                                                                 // any dead slots are gone now
+    head_valid = false;
+    std::fill(tombstones.begin(), tombstones.end(), 0);
+    if(count > 0){
+        _init_heaps(partition, threads);                                                            // rebuild from the first hole to the end
+    }
+    else{
+        bounds.clear();
+    }
+    return removed;
+}
+
+/*
+ * Moves the values of two sequences of runs into new partitions, starting at slot
+ * `count` (which must be a partition boundary, with the storage already allocated),
+ * so that every partition is in range order and full but the last; each partition is
+ * heapified, but the bounds and the filter are left to the caller.  In each sequence
+ * no value of a run may be less than any value of an earlier run (as with the
+ * partitions of a HeapArray).  Each partition is filled from a pool of the runs taken
+ * so far: while the values that would fill it aren't all no greater than the minimum
+ * of each sequence's next run, the run with the smallest minimum joins the pool.
+ *     first_runs   the first sequence of runs (its values are moved from)
+ *     second_runs  the second sequence of runs (its values are moved from)
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_append_runs(const std::vector<run>& first_runs, const std::vector<run>& second_runs){
+    const std::vector<run>* sources[2] = {&first_runs, &second_runs};
+    size_t                  next[2]    = {0, 0};
+    const DataType*         lowest[2]  = {nullptr, nullptr};                                        // minimum of each sequence's next run
+    auto total = count;
+    for(auto source : sources){
+        for(auto& r : *source){
+            total += r.second - r.first;
+        }
+    }
+    auto advance = [&](int s){                                                                      // skip to the next non-empty run
+        while(next[s] < sources[s]->size() && (*sources[s])[next[s]].first == (*sources[s])[next[s]].second){
+            ++next[s];
+        }
+        lowest[s] = next[s] < sources[s]->size() ? &*std::min_element((*sources[s])[next[s]].first, (*sources[s])[next[s]].second, comp) : nullptr;
+    };
+    advance(0);
+    advance(1);
+    std::vector<DataType> pool;
+    auto take = [&](int s){
+        auto& r = (*sources[s])[next[s]++];
+        pool.insert(pool.end(), std::make_move_iterator(r.first), std::make_move_iterator(r.second));
+        advance(s);
+    };
+    auto smaller = [&](){                                                                           // the sequence with the smallest next run
+        return !lowest[0] ? 1 : !lowest[1] ? 0 : comp(*lowest[1], *lowest[0]) ? 1 : 0;
+    };
+    for(auto p = count > 0 ? _final_partition() + 1 : 0; count < total; ++p){
+        auto want = std::min(_partition_size(p), total - count);
+        while(pool.size() < want){
+            take(smaller());
+        }
+        for(;;){
+            std::nth_element(pool.begin(), pool.begin() + (want - 1), pool.end(), comp);
+            auto s = smaller();
+            if(!lowest[s] || !comp(*lowest[s], pool[want - 1])){                                    // nothing left out belongs in here
+                break;
+            }
+            take(s);
+        }
+        for(size_t i = 0; i < want; ++i){
+            _construct(count + i, std::move(pool[i]));
+        }
+        pool.erase(pool.begin(), pool.begin() + want);
+        mmheap::make_heap(_partition_data(p), want, comp);
+        _set_count(count + want);
+    }
+}
+
+/*
+ * Moves everything from offset `keep` of the partition whose partition-index is `p`
+ * on (the partition's values from `keep` on must be no less than those before, and
+ * there must be no dead slots) into a new HeapArray with the same options, and
+ * returns it; the partition then ends at `keep`, and is re-heapified.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats> HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_split(size_t p, size_t keep){
+    HeapArray upper(comp, equal, alloc_traits::select_on_container_copy_construction(alloc));
+    upper.lazy           = lazy;
+    upper.lazy_threshold = lazy_threshold;
+    upper.cache_bounds   = cache_bounds;
+    upper.filtering      = filtering;
+    auto cut = count > 0 && p <= _final_partition() ? _partition_start(p) + keep : count;
+    if(fixed){
+        upper._allocate(storage);                                                                   // (the same capacity as this one)
+        upper.fixed = true;
+    }
+    else{
+        upper._allocate(count - cut);
+    }
+    if(cut < count){
+        std::vector<run> moved;
+        for(auto q = p; q <= _final_partition(); ++q){
+            auto data = _partition_data(q);
+            moved.emplace_back(data + (q == p ? keep : 0), data + _count_in_partition(q));
+        }
+        for(auto i = cut; filtering && i < count; ++i){
+            _filter_removed(_slot(i));
+        }
+        upper._append_runs(moved, {});
+        head_valid = false;
+        _destroy(cut, count);
+        _set_count(cut);
+        if(keep > 0){
+            mmheap::make_heap(_partition_data(p), keep, comp);
+        }
+        _update_bounds_from(keep > 0 ? p : _final_partition());
+        upper._update_bounds_from(0);
+    }
+    if(filtering){
+        upper._rebuild_filter();
+    }
+    return upper;
+}
+
+/*
+ * Finds the partition-index of the first partition whose maximum value is not
+ * less than `value` (no value in any earlier partition can be equal to or greater
+ * than `value`).  Returns `_final_partition() + 1` if there is no such partition.
+ *     value    the value to search for
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_lower_bound_partition(const DataType& value)const{
+    size_t left  = _first_live_partition();
+    size_t right = count > 0 ? _final_partition() + 1 : 0;
+    while(left < right){                                                                            // binary search on the partition maxima
+        auto mid = left + (right - left) / 2;
+        if(comp(_max_in_partition(mid), value)){
+            left = mid + 1;
+        }
+        else{
+            right = mid;
+        }
+    }
+    return left;
+}
+
+/*
+ * Finds the partition-index of the first partition whose minimum value is greater
+ * than `value` (every value in every later partition is greater than `value`, too).
+ * Returns `_final_partition() + 1` if there is no such partition.
+ *     value    the value to search for
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_upper_bound_partition(const DataType& value)const{
+    size_t left  = _first_live_partition();
+    size_t right = count > 0 ? _final_partition() + 1 : 0;
+    while(left < right){                                                                            // binary search on the partition minima
+        auto mid = left + (right - left) / 2;
+        if(!comp(value, *_partition_data(mid))){
+            left = mid + 1;
+        }
+        else{
+            right = mid;
+        }
+    }
+    return left;
+}
+
+/*
+ * Get the number of live (not removed) values in the partition whose partition-index is `p`.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_live_in_partition(size_t p)const{
+    auto n = _count_in_partition(p);
+    if(dead_count > 0 && p <= _index_to_partition(dead_last) && _partition_start(p + 1) > dead_first){
+        for(auto i = _partition_start(p); i < _partition_start(p) + _count_in_partition(p); ++i){
+            n -= _is_dead(i) ? 1 : 0;
+        }
+    }
+    return n;
+}
+
+/*
+ * Get the number of live values in the partitions before partition-index `p`.  While
+ * the only dead slots are those `pop_min` left at the front, every slot after the
+ * partition being drained is live, so this is O(1); otherwise the partitions are
+ * counted one by one.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_live_before(size_t p)const{
+    auto first = _first_live_partition();
+    if(p <= first){
+        return 0;
+    }
+    if(dead_count == 0 || (head_valid && dead_last < _partition_start(head_p + 1))){
+        return _heap_count(first) + std::min(_partition_start(p), count) - std::min(_partition_start(first + 1), count);
+    }
+    size_t n = 0;
+    for(auto q = first; q < p; ++q){
+        n += _live_in_partition(q);
+    }
+    return n;
+}
+
+/*
+ * Finds the partition-index of the partition holding the `k`th smallest live value
+ * (counting from 0); `k` must be less than `size()`.  O(1) in the same cases as
+ * `_live_before`.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_select_partition(size_t k)const{
+    auto first = _first_live_partition();
+    if(dead_count == 0 || (head_valid && dead_last < _partition_start(head_p + 1))){
+        auto n = _heap_count(first);
+        return k < n ? first : _index_to_partition(_partition_start(first + 1) + k - n);            // (slot index = rank past the front)
+    }
+    auto p = first;
+    for(auto n = _live_in_partition(p); k >= n; n = _live_in_partition(++p)){
+        k -= n;
+    }
+    return p;
+}
+
+/*
+ * Searches for each of `keys[0..k)` as `_find` does, calling `report(i, found, index)`
+ * for each key `i` (not necessarily in order of `i`).  The partition searches run
+ * FIND_GROUP_SIZE keys at a time: the group's binary searches (the same search as
+ * `_find_partition`) advance one step at a time together, each key's next probe
+ * being prefetched as soon as it is known, so the misses of a whole group overlap.
+ * Then, if the structure is too large to stay in cache (FIND_SORT_BYTES) and there
+ * are more keys than partitions, the keys are scanned for partition by partition (a
+ * counting sort on their partition-indices), so all of the scans of a partition run
+ * back to back on a partition already in cache, instead of each key streaming its
+ * partition in from memory again.
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+template <typename Report>
+void HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_find_group(const DataType* keys, size_t k, Report report)const{
+    _heaparray::stats_scope<Stats> scope(stats, heaparray_op::find_many);
+    if(count == 0){
+        for(size_t i = 0; i < k; ++i){
+            report(i, false, 0);
+        }
+        return;
+    }
+    size_t first        = _first_live_partition();
+    size_t absent       = _final_partition() + 1;                                                   // (the "partition" of keys the filter rejects)
+    bool   by_partition = k > _final_partition() && count * sizeof(DataType) >= FIND_SORT_BYTES;   // (enough keys per partition to share its
+    std::vector<size_t> partition(by_partition ? k : 0, first);                                     // scans, and too large to stay in cache)
+    size_t   group_partition[FIND_GROUP_SIZE], left[FIND_GROUP_SIZE], right[FIND_GROUP_SIZE];
+    bool     searching[FIND_GROUP_SIZE];
+    uint64_t hash[FIND_GROUP_SIZE];
+    size_t   steps[FIND_GROUP_SIZE];                                                                // (counted only for a statistics policy)
+    for(size_t group = 0; group < k; group += FIND_GROUP_SIZE){
+        auto   n      = std::min(FIND_GROUP_SIZE, k - group);
+        auto   key    = keys + group;
+        auto   found  = by_partition ? partition.data() + group : group_partition;
+        size_t active = n;
+        for(size_t j = 0; filtering && j < n; ++j){
+            hash[j] = _filter_hash(key[j]);                                                         // the group's filter lookups overlap, too
+            _heaparray::prefetch(membership.address(hash[j]));
+        }
+        for(size_t j = 0; j < n; ++j){
+            found[j]     = first;                                                                   // (where `_find_partition` gives up)
+            left[j]      = first;
+            right[j]     = _final_partition();
+            searching[j] = !filtering || membership.maybe_contains(hash[j]);
+            steps[j]     = 0;
+            if(searching[j]){
+                _heaparray::prefetch(_probe_address((left[j] + right[j]) / 2));
+            }
+            else{
+                found[j] = absent;
+                --active;
+            }
+        }
+        while(active > 0){                                                                          // one step of every key's search:
+            for(size_t j = 0; j < n; ++j){
+                if(!searching[j]){
+                    continue;
+                }
+                auto mid   = (left[j] + right[j]) / 2;
+                auto range = _range_in_partition(mid);
+                if constexpr(counting){
+                    ++steps[j];
+                }
+                if(!comp(key[j], range.first) && !comp(range.second, key[j])){
+                    found[j]     = mid;
+                    searching[j] = false;
+                }
+                else if(comp(range.second, key[j])){
+                    left[j]      = mid + 1;
+                    searching[j] = left[j] <= right[j];
+                }
+                else{
+                    right[j]     = mid - 1;
+                    searching[j] = mid > first && left[j] <= right[j];
+                }
+                if(searching[j]){
+                    _heaparray::prefetch(_probe_address((left[j] + right[j]) / 2));                 // the key's next probe
+                }
+                else{
+                    --active;
+                    stats.search(steps[j]);
+                    if(!by_partition){
+                        _heaparray::prefetch(_partition_data(found[j]));                            // the partition it will scan
+                    }
+                }
+            }
+        }
+        for(size_t j = 0; !by_partition && j < n; ++j){
+            auto result = found[j] != absent ? _find_in(key[j], found[j]) : std::make_tuple(false, size_t{0}, size_t{0}, size_t{0});
+            report(group + j, std::get<0>(result), std::get<1>(result));
+        }
+    }
+    if(!by_partition){
+        return;
+    }
+    std::vector<size_t> start(absent + 2, 0);                                                       // counting sort of the keys by partition
+    for(auto p : partition){
+        ++start[p + 1];
+    }
+    std::partial_sum(start.begin(), start.end(), start.begin());
+    std::vector<size_t> order(k);
+    for(size_t i = 0; i < k; ++i){
+        order[start[partition[i]]++] = i;
+    }
+    for(auto i : order){
+        auto result = partition[i] != absent ? _find_in(keys[i], partition[i]) : std::make_tuple(false, size_t{0}, size_t{0}, size_t{0});
+        report(i, std::get<0>(result), std::get<1>(result));
+    }
+}
+
+/*
+ * Get the address the partition search reads first when it probes the partition
+ * whose partition-index is `p` (its cached bounds, or else its heap root).
+ */
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+inline const void* HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_probe_address(size_t p)const{
+    if(cache_bounds){
+        return bounds.data() + p;
+    }
+    return _partition_data(p);
+}
+
 /*
  * Finds the partition-index of the partition that contains `value`, or
  * (optionally) the partition-index of the partition that _should_ contain
@@ -522,41 +3916,77 @@ std::tuple<bool, size_t, size_t, size_t> HeapArray<DataType>::_find(const DataTy
  *     for_insert   flag indicating whether this is a speculative search prior
  *                  to an insert.
  */
-template <typename DataType>
-size_t HeapArray<DataType>::_find_partition(const DataType& value, bool for_insert)const{
-    size_t p_index = 0;
+template <typename DataType, typename Compare, typename Equal, typename Allocator, typename Storage, typename Geometry, typename Stats>
+size_t HeapArray<DataType, Compare, Equal, Allocator, Storage, Geometry, Stats>::_find_partition(const DataType& value, bool for_insert)const{
+    size_t first   = _first_live_partition();                                                      // (the search skips partitions `pop_min`
+    size_t p_index = first;                                                                         // has drained)
     if(count > 0){
-        size_t left     = 0;
+        size_t left     = first;
         size_t right    = _final_partition();
         bool   finished = false;
+        size_t steps    = 0;
         while(!finished && left <= right){                                                          // binary search for the partition containing value:
             auto mid   = (left + right) / 2;
+            ++steps;
 
             auto range = _range_in_partition(mid);
-            if(((range.first < value || range.first == value)
-                && (value < range.second || value == range.second)) ||                              // value within range
+            if((!comp(value, range.first)
+                && !comp(range.second, value)) ||                                                   // value within range
                 (for_insert &&                                                                      // or, if we are inserting
-                    ((mid > 0  && (value < range.second || value == range.second)
-                        && _max_in_partition(mid-1) <= value)                                       //     follows previous partition
-                     || (mid == 0 && (value < range.second || value == range.second))               //     or mid is first partition, value <= max
+                    ((mid > first && !comp(range.second, value)
+                        && !comp(value, _max_in_partition(mid-1)))                                  //     follows previous partition
+                     || (mid == first && !comp(range.second, value))                                //     or mid is first partition, value <= max
                      || (mid == _final_partition()
-                        && (range.first < value || range.first == value)))))                        //     or mid is last partition, value >= min
+                        && !comp(value, range.first)))))                                            //     or mid is last partition, value >= min
             {
                 p_index  = mid;
                 finished = true;
             }
-            else if(range.second < value){
+            else if(comp(range.second, value)){
                 left = mid + 1;
             }
             else{
                 right = mid - 1;
-                if(mid == 0){
+                if(mid == first){
                     finished = true;                                                                // edge case: right can't become negative, so it would underflow
                 }
             }
         }
+        stats.search(steps);
     }
     return p_index;
 }
 
+/**
+ * A HeapArray ordered largest-first: `min()` returns the largest value and
+ * `max()` the smallest.
+ *
+ * @tparam  DataType    the type of data stored in the heap
+ */
+template <typename DataType>
+using MaxHeapArray = HeapArray<DataType, std::greater<DataType>>;
+
+/**
+ * A HeapArray in segmented storage: growing never moves the values already stored.
+ *
+ * @tparam  DataType    the type of data stored in the heap
+ * @tparam  Compare     the type of the function object that orders the values
+ * @tparam  Equal       the type of the function object used to match values
+ */
+template <typename DataType, typename Compare = std::less<DataType>, typename Equal = std::equal_to<DataType>>
+using SegmentedHeapArray = HeapArray<DataType, Compare, Equal, std::allocator<DataType>, segmented_storage>;
+
+#if defined(__cpp_lib_memory_resource)                                                             // (libstdc++ ships the header, empty, before C++17)
+/**
+ * A HeapArray whose storage comes from a `std::pmr::memory_resource` (such as a
+ * `std::pmr::monotonic_buffer_resource` arena), given at construction.
+ *
+ * @tparam  DataType    the type of data stored in the heap
+ * @tparam  Compare     the type of the function object that orders the values
+ * @tparam  Equal       the type of the function object used to match values
+ */
+template <typename DataType, typename Compare = std::less<DataType>, typename Equal = std::equal_to<DataType>>
+using PmrHeapArray = HeapArray<DataType, Compare, Equal, std::pmr::polymorphic_allocator<DataType>>;
+#endif
+
 #endif
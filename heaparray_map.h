@@ -0,0 +1,350 @@
+#ifndef HEAPARRAY_MAP_H
+#define HEAPARRAY_MAP_H
+/**
+ * @file heaparray_map.h
+ *
+ * Defines the HeapArrayMap, a HeapArray of keys where each key carries a
+ * payload value.  Only a small (key, slot) entry lives in the partitioned
+ * heaps, so sifts, ripples and partition scans move and compare keys only.
+ * The payloads sit in a separate (chunked) array, indexed by slot, and never
+ * move while their key is in the map, not even when the array grows.
+ *
+ *
+ * @author    Jason L Causey
+ * @license   Released under the MIT License: http://opensource.org/licenses/MIT
+ * @copyright Copyright (c) 2015 Jason L Causey, Arkansas State University
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "heaparray.h"
+
+namespace _heaparray{
+    /**
+     * an entry in a HeapArrayMap's heaps: the key, plus the index of its payload
+     * in the payload array
+     */
+    template <typename Key>
+    struct map_entry{
+        Key         key;
+        uint32_t    slot;
+    };
+
+    /*
+     * applies a key comparison (or equality) function object to the keys of two entries
+     */
+    template <typename Key, typename KeyCompare>
+    struct map_entry_compare{
+        KeyCompare comp;
+        bool operator()(const map_entry<Key>& lhs, const map_entry<Key>& rhs)const{
+            return comp(lhs.key, rhs.key);
+        }
+    };
+}
+
+/**
+ * A HeapArray of keys with an associated payload per key (duplicate keys are
+ * allowed, as in a multimap).  The heaps hold (key, slot) entries, so the data
+ * moved by a sift or ripple, and the data touched by a search, is the key plus a
+ * 4-byte slot index, whatever the size of the payload.  Each payload is stored
+ * once in a separate array (a `std::deque`, so adding payloads never moves the
+ * others) and stays where it is until its key is removed.
+ *
+ * @tparam  Key         the type of the keys - same requirements as the `DataType`
+ *                      of a HeapArray
+ * @tparam  Value       the type of the payloads - must be DefaultConstructable and
+ *                      MoveAssignable
+ * @tparam  Compare     the type of the function object that orders the keys
+ *                      (`std::less<Key>` by default)
+ * @tparam  Equal       the type of the function object used to match keys in
+ *                      searches (`std::equal_to<Key>` by default)
+ */
+template <typename Key, typename Value, typename Compare = std::less<Key>, typename Equal = std::equal_to<Key>>
+class HeapArrayMap{
+public:
+    HeapArrayMap() = default;
+    explicit HeapArrayMap(const Compare& compare, const Equal& equality = Equal());
+
+    void                    insert(const Key& key, Value value);
+    bool                    remove(const Key& key);
+    template <typename Predicate>
+    size_t                  erase_if(Predicate pred);
+    Value*                  find(const Key& key);
+    const Value*            find(const Key& key)const;
+    bool                    contains(const Key& key)const;
+    Value&                  at(const Key& key);
+    const Value&            at(const Key& key)const;
+    std::pair<Key, const Value&>
+                            min()const;
+    std::pair<Key, const Value&>
+                            max()const;
+    size_t                  size()const;
+    bool                    empty()const;
+    void                    set_lazy_remove(bool enable, double compact_threshold = 0.25);
+    void                    compact();
+
+protected:
+    typedef _heaparray::map_entry<Key>                  entry;
+    typedef _heaparray::map_entry_compare<Key, Compare> entry_compare;
+    typedef _heaparray::map_entry_compare<Key, Equal>   entry_equal;
+
+    uint32_t                _acquire_slot(Value&& value);
+    void                    _release_slot(uint32_t slot);
+
+    HeapArray<entry, entry_compare, entry_equal> entries;                                           // the keys, in heap order
+    std::deque<Value>                            payloads;                                          // payloads, indexed by entry slot (a deque,
+                                                                                                    // so growing never moves them)
+    std::vector<uint32_t>                        free_slots;                                        // released payload slots, for re-use
+};
+
+/**
+ * Construct an empty HeapArrayMap that orders its keys with `compare` and matches
+ * them with `equality`.
+ *
+ * @param compare   the key comparison function object
+ * @param equality  the key equality function object
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+HeapArrayMap<Key, Value, Compare, Equal>::HeapArrayMap(const Compare& compare, const Equal& equality)
+    : entries(entry_compare{compare}, entry_equal{equality}){
+}
+
+/**
+ * @brief   Insert a key and its payload into the HeapArrayMap.
+ * @details The payload is moved into the payload array once; afterward only the
+ *          (key, slot) entry takes part in the HeapArray's ripple.
+ *
+ * @param key    the key to insert
+ * @param value  the payload to associate with `key`
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+void HeapArrayMap<Key, Value, Compare, Equal>::insert(const Key& key, Value value){
+    auto slot = _acquire_slot(std::move(value));
+    entries.insert(entry{key, slot});
+}
+
+/**
+ * Remove one instance of `key` (and its payload) from the HeapArrayMap, if it
+ * exists.  If the key occurs more than once, the instance removed is the one
+ * `find` would have returned.
+ *
+ * @param key the key to remove
+ * @return true if `key` was found and removed, false otherwise
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+bool HeapArrayMap<Key, Value, Compare, Equal>::remove(const Key& key){
+    entry probe{key, 0};
+    auto  found = entries.find(probe);
+    if(!found.first){
+        return false;
+    }
+    auto slot = entries[found.second].slot;                                                         // the HeapArray's search is deterministic, so
+    entries.remove(probe);                                                                          // it removes the same entry found here
+    _release_slot(slot);
+    return true;
+}
+
+/**
+ * Remove every key for which `pred(key, value)` returns true, along with its
+ * payload, in one compaction pass over the heaps.
+ *
+ * @param pred    `bool pred(const Key&, const Value&)`; true for entries to remove
+ * @tparam Predicate  the type of the predicate
+ * @return the number of keys removed
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+template <typename Predicate>
+size_t HeapArrayMap<Key, Value, Compare, Equal>::erase_if(Predicate pred){
+    return entries.erase_if([this, &pred](const entry& e){
+        bool victim = pred(e.key, static_cast<const Value&>(payloads[e.slot]));
+        if(victim){
+            _release_slot(e.slot);
+        }
+        return victim;
+    });
+}
+
+/**
+ * Find the payload associated with `key`.
+ *
+ * @param key the key to search for
+ * @return a pointer to the payload of (one instance of) `key`, or nullptr if `key` is not present;
+ *         the pointer remains valid until that key is removed
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+Value* HeapArrayMap<Key, Value, Compare, Equal>::find(const Key& key){
+    auto found = entries.find(entry{key, 0});
+    return found.first ? &payloads[entries[found.second].slot] : nullptr;
+}
+
+/**
+ * Find the payload associated with `key`.
+ *
+ * @param key the key to search for
+ * @return a pointer to the payload of (one instance of) `key`, or nullptr if `key` is not present
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+const Value* HeapArrayMap<Key, Value, Compare, Equal>::find(const Key& key)const{
+    auto found = entries.find(entry{key, 0});
+    return found.first ? &payloads[entries[found.second].slot] : nullptr;
+}
+
+/**
+ * Determine whether or not the HeapArrayMap contains `key`.
+ *
+ * @param key the key to search for
+ * @return true if `key` is present, false otherwise
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+bool HeapArrayMap<Key, Value, Compare, Equal>::contains(const Key& key)const{
+    return entries.contains(entry{key, 0});
+}
+
+/**
+ * Access the payload associated with `key`.
+ *
+ * @param key the key to search for
+ * @return a reference to the payload of (one instance of) `key`
+ * @throws std::out_of_range if `key` is not present
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+Value& HeapArrayMap<Key, Value, Compare, Equal>::at(const Key& key){
+    auto value = find(key);
+    if(!value){
+        throw std::out_of_range("Key not found.");
+    }
+    return *value;
+}
+
+/**
+ * Access the payload associated with `key`.
+ *
+ * @param key the key to search for
+ * @return a reference to the payload of (one instance of) `key`
+ * @throws std::out_of_range if `key` is not present
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+const Value& HeapArrayMap<Key, Value, Compare, Equal>::at(const Key& key)const{
+    auto value = find(key);
+    if(!value){
+        throw std::out_of_range("Key not found.");
+    }
+    return *value;
+}
+
+/**
+ * Get the smallest key (in `Compare` order) and its payload.  The HeapArrayMap
+ * must not be empty.
+ *
+ * @return the minimum key and a reference to its payload
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+std::pair<Key, const Value&> HeapArrayMap<Key, Value, Compare, Equal>::min()const{
+    auto e = entries.min();
+    return std::pair<Key, const Value&>(e.key, payloads[e.slot]);
+}
+
+/**
+ * Get the largest key (in `Compare` order) and its payload.  The HeapArrayMap
+ * must not be empty.
+ *
+ * @return the maximum key and a reference to its payload
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+std::pair<Key, const Value&> HeapArrayMap<Key, Value, Compare, Equal>::max()const{
+    auto e = entries.max();
+    return std::pair<Key, const Value&>(e.key, payloads[e.slot]);
+}
+
+/**
+ * Get the number of keys in the HeapArrayMap.
+ *
+ * @return the number of keys (and payloads) stored
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+size_t HeapArrayMap<Key, Value, Compare, Equal>::size()const{
+    return entries.size();
+}
+
+/**
+ * Determine whether the HeapArrayMap is empty.
+ *
+ * @return true if there are no keys stored, false otherwise
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+bool HeapArrayMap<Key, Value, Compare, Equal>::empty()const{
+    return entries.size() == 0;
+}
+
+/**
+ * Enable or disable lazy (tombstone) removal of keys; see `HeapArray::set_lazy_remove`.
+ * Payloads are released immediately in either mode.
+ *
+ * @param enable             true to mark removed keys dead instead of rippling
+ * @param compact_threshold  fraction of dead slots that triggers a compaction
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+void HeapArrayMap<Key, Value, Compare, Equal>::set_lazy_remove(bool enable, double compact_threshold){
+    entries.set_lazy_remove(enable, compact_threshold);
+}
+
+/**
+ * Compact any dead (lazily removed) key slots; see `HeapArray::compact`.
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+void HeapArrayMap<Key, Value, Compare, Equal>::compact(){
+    entries.compact();
+}
+
+/*
+ * Store `value` in a free payload slot (re-using a released one if possible) and
+ * return the slot's index.
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+uint32_t HeapArrayMap<Key, Value, Compare, Equal>::_acquire_slot(Value&& value){
+    if(!free_slots.empty()){
+        auto slot = free_slots.back();
+        free_slots.pop_back();
+        payloads[slot] = std::move(value);
+        return slot;
+    }
+    if(payloads.size() >= UINT32_MAX){
+        throw std::length_error("HeapArrayMap payload slots exhausted.");
+    }
+    payloads.push_back(std::move(value));
+    return static_cast<uint32_t>(payloads.size() - 1);
+}
+
+/*
+ * Release the payload in `slot` (resetting it to a default value so that any
+ * resources it owns are freed now) and make the slot available for re-use.
+ */
+template <typename Key, typename Value, typename Compare, typename Equal>
+void HeapArrayMap<Key, Value, Compare, Equal>::_release_slot(uint32_t slot){
+    payloads[slot] = Value();
+    free_slots.push_back(slot);
+}
+
+#endif
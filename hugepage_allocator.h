@@ -0,0 +1,245 @@
+#ifndef HUGEPAGE_ALLOCATOR_H
+#define HUGEPAGE_ALLOCATOR_H
+/**
+ * @file hugepage_allocator.h
+ *
+ * Defines `hugepage_allocator`, an allocator for large HeapArrays that backs
+ * big blocks with huge pages (transparent huge pages via `madvise`, or explicit
+ * 2MB / 1GB pages via `MAP_HUGETLB`), and can bind or interleave them across
+ * NUMA nodes (via the `mbind` system call, so libnuma is not needed).
+ * Blocks smaller than one huge page come from `operator new` as usual.  On
+ * anything other than Linux, every block comes from `operator new` and the
+ * options are ignored.
+ *
+ *
+ * @author    Jason L Causey
+ * @license   Released under the MIT License: http://opensource.org/licenses/MIT
+ * @copyright Copyright (c) 2015 Jason L Causey, Arkansas State University
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "heaparray.h"
+
+#if defined(__linux__)
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+/**
+ * How a `hugepage_allocator` backs large blocks.
+ */
+enum class hugepage_mode{
+    none,                                                                                           // ordinary pages (NUMA placement only)
+    transparent,                                                                                    // ordinary mapping + madvise(MADV_HUGEPAGE)
+    explicit_2mb,                                                                                   // MAP_HUGETLB with 2MB pages
+    explicit_1gb                                                                                    // MAP_HUGETLB with 1GB pages
+};
+
+/**
+ * Where a `hugepage_allocator` places large blocks on a NUMA machine.
+ */
+enum class numa_policy{
+    local,                                                                                          // the kernel default (first touch)
+    preferred,                                                                                      // prefer the first node in the mask
+    bind,                                                                                           // only the nodes in the mask
+    interleave                                                                                      // round-robin pages across the mask
+};
+
+namespace _heaparray{
+    const size_t HUGEPAGE_2MB = size_t{1} << 21;
+    const size_t HUGEPAGE_1GB = size_t{1} << 30;
+
+    /*
+     * the page size that large blocks are rounded up to in mode `mode`
+     */
+    inline size_t hugepage_size(hugepage_mode mode){
+        return mode == hugepage_mode::explicit_1gb ? HUGEPAGE_1GB : HUGEPAGE_2MB;
+    }
+
+    /**
+     * @brief   map `bytes` (a multiple of the mode's page size) of anonymous memory
+     * @details Explicit huge pages fall back to an ordinary mapping (with the
+     *          transparent huge page hint) if the kernel has none to spare.  The
+     *          NUMA policy is applied before any page is touched.
+     *
+     * @param  bytes   size of the mapping
+     * @param  mode    huge page mode
+     * @param  policy  NUMA placement policy
+     * @param  nodes   bit mask of the NUMA nodes to use (ignored for `numa_policy::local`)
+     * @return the address of the mapping
+     * @throws std::bad_alloc if the memory can't be mapped
+     */
+    inline void* map_large_block(size_t bytes, hugepage_mode mode, numa_policy policy, unsigned long nodes){
+#if defined(__linux__)
+        void* block = MAP_FAILED;
+        if(mode == hugepage_mode::explicit_2mb || mode == hugepage_mode::explicit_1gb){
+    #if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+            int size_flag = (mode == hugepage_mode::explicit_1gb ? 30 : 21) << MAP_HUGE_SHIFT;
+            block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | size_flag, -1, 0);
+    #endif
+        }
+        if(block == MAP_FAILED){
+            block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(block == MAP_FAILED){
+                throw std::bad_alloc();
+            }
+    #if defined(MADV_HUGEPAGE)
+            if(mode != hugepage_mode::none){
+                madvise(block, bytes, MADV_HUGEPAGE);                                               // (only a hint: failure is harmless)
+            }
+    #endif
+        }
+    #if defined(SYS_mbind)
+        if(policy != numa_policy::local && nodes != 0){
+            int mpol = static_cast<int>(policy);                                                    // (numa_policy matches MPOL_DEFAULT,
+            syscall(SYS_mbind, block, bytes, mpol, &nodes,                                          //  _PREFERRED, _BIND and _INTERLEAVE)
+                    sizeof(nodes) * 8 + 1, 0);                                                      // (a hint too: failure is harmless)
+        }
+    #endif
+        return block;
+#else
+        (void)mode, (void)policy, (void)nodes;
+        return ::operator new(bytes);
+#endif
+    }
+
+    /*
+     * unmap a block returned by `map_large_block`
+     */
+    inline void unmap_large_block(void* block, size_t bytes){
+#if defined(__linux__)
+        munmap(block, bytes);
+#else
+        (void)bytes;
+        ::operator delete(block);
+#endif
+    }
+}
+
+/**
+ * @brief   An allocator for large HeapArrays, backed by huge pages.
+ * @details Blocks of at least one huge page are mapped directly (rounded up to
+ *          whole huge pages) with the requested huge page mode and NUMA policy;
+ *          smaller blocks use `operator new`.  Fewer, larger pages means far fewer
+ *          TLB misses in the partition search of a multi-GB HeapArray.
+ *          Pass one to a HeapArray constructor, e.g.
+ *          `HugePageHeapArray<int> h(n, true, hugepage_allocator<int>(hugepage_mode::transparent, numa_policy::interleave, 0x3));`
+ *
+ * @tparam  T   the type of value allocated
+ */
+template <typename T>
+class hugepage_allocator{
+public:
+    typedef T value_type;
+
+    /**
+     * Create an allocator with the given huge page mode and NUMA placement.
+     *
+     * @param page_mode  how to back large blocks (transparent huge pages by default)
+     * @param placement  NUMA placement of large blocks (the kernel default if not given)
+     * @param node_mask  bit mask of the NUMA nodes for `placement` (node `i` is bit `i`)
+     */
+    explicit hugepage_allocator(hugepage_mode page_mode = hugepage_mode::transparent,
+                                numa_policy placement = numa_policy::local, unsigned long node_mask = 0)
+        : mode(page_mode), policy(placement), nodes(node_mask){}
+
+    /**
+     * Copy the options of an allocator for another type.
+     *
+     * @param other  the allocator to copy
+     */
+    template <typename U>
+    hugepage_allocator(const hugepage_allocator<U>& other)
+        : mode(other.mode), policy(other.policy), nodes(other.nodes){}
+
+    /**
+     * Allocate (uninitialized) storage for `n` values.
+     *
+     * @param  n  number of values
+     * @return pointer to the storage
+     * @throws std::bad_alloc if the memory can't be allocated
+     */
+    T* allocate(size_t n){
+        auto bytes = n * sizeof(T);
+        if(bytes < _heaparray::hugepage_size(mode)){
+            return static_cast<T*>(::operator new(bytes));
+        }
+        return static_cast<T*>(_heaparray::map_large_block(_rounded(bytes), mode, policy, nodes));
+    }
+
+    /**
+     * Release storage returned by `allocate(n)`.
+     *
+     * @param block  the storage
+     * @param n      the number of values it was allocated for
+     */
+    void deallocate(T* block, size_t n){
+        auto bytes = n * sizeof(T);
+        if(bytes < _heaparray::hugepage_size(mode)){
+            ::operator delete(block);
+        }
+        else{
+            _heaparray::unmap_large_block(block, _rounded(bytes));
+        }
+    }
+
+    /**
+     * Allocators are interchangeable if they round large blocks to the same page size.
+     */
+    template <typename U>
+    bool operator==(const hugepage_allocator<U>& rhs)const{
+        return _heaparray::hugepage_size(mode) == _heaparray::hugepage_size(rhs.mode);
+    }
+    template <typename U>
+    bool operator!=(const hugepage_allocator<U>& rhs)const{
+        return !(*this == rhs);
+    }
+
+private:
+    template <typename U> friend class hugepage_allocator;
+
+    /*
+     * `bytes` rounded up to a whole number of huge pages
+     */
+    size_t _rounded(size_t bytes)const{
+        auto page = _heaparray::hugepage_size(mode);
+        return (bytes + page - 1) / page * page;
+    }
+
+    hugepage_mode   mode;
+    numa_policy     policy;
+    unsigned long   nodes;
+};
+
+/**
+ * A HeapArray whose storage comes from a `hugepage_allocator`.
+ *
+ * @tparam  DataType    the type of data stored in the heap
+ * @tparam  Compare     the type of the function object that orders the values
+ * @tparam  Equal       the type of the function object used to match values
+ */
+template <typename DataType, typename Compare = std::less<DataType>, typename Equal = std::equal_to<DataType>>
+using HugePageHeapArray = HeapArray<DataType, Compare, Equal, hugepage_allocator<DataType>>;
+
+#endif
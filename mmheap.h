@@ -46,6 +46,7 @@
 #include <cmath>
 #include <stdexcept>
 #include <cassert>
+#include <functional>
 
 /**
  * The `_mmheap` namespace contains functions that are only intended for internal
@@ -108,16 +109,21 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return  a pair where the first element is `true` if `i` has children (`false`
      *          otherwise), and the second element is the index of the child whose value
      *          is smallest (only if the first element is `true`)
      */
-    template <typename DataType>
-    std::pair<bool, size_t> min_child(DataType* heap_array, size_t i, size_t right_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    std::pair<bool, size_t> min_child(const DataType* heap_array, size_t i, size_t right_index, Compare comp = Compare()){
         std::pair<bool, size_t> result{false, 0};
         if(left(i) <= right_index){
             auto m = left(i);
-            if(right(i) <= right_index && heap_array[right(i)] < heap_array[m]){
+            if(right(i) <= right_index && comp(heap_array[right(i)], heap_array[m])){
                 m = right(i);
             }
             result = {true, m};
@@ -135,24 +141,29 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return  a pair where the first element is `true` if `i` has grandchildren
      *          (`false` otherwise), and the second element is the index of the
      *          grandchild whose value is smallest (only if the first element is `true`)
      */
-    template <typename DataType>
-    std::pair<bool, size_t> min_gchild(DataType* heap_array, size_t i, size_t right_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    std::pair<bool, size_t> min_gchild(const DataType* heap_array, size_t i, size_t right_index, Compare comp = Compare()){
         std::pair<bool, size_t> result{false, 0};
         auto l = left(i);
         auto r = right(i);
         if(left(l) <= right_index){
             auto m = left(l);
-            if(right(l) <= right_index && heap_array[right(l)] < heap_array[m]){
+            if(right(l) <= right_index && comp(heap_array[right(l)], heap_array[m])){
                 m = right(l);
             }
-            if(left(r) <= right_index && heap_array[left(r)] < heap_array[m]){
+            if(left(r) <= right_index && comp(heap_array[left(r)], heap_array[m])){
                 m = left(r);
             }
-            if(right(r) <= right_index && heap_array[right(r)] < heap_array[m]){
+            if(right(r) <= right_index && comp(heap_array[right(r)], heap_array[m])){
                 m = right(r);
             }
             result = {true, m};
@@ -170,17 +181,22 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return  a pair where the first element is `true` if `i` has children
      *          (`false` otherwise), and the second element is the index of the
      *          child or grandchild whose value is smallest (only if the first
      *          element is `true`)
      */
-    template <typename DataType>
-    std::pair<bool, size_t> min_child_or_gchild(DataType* heap_array, size_t i, size_t right_index){
-        auto m = min_child(heap_array, i, right_index);
+    template <typename DataType, typename Compare = std::less<DataType>>
+    std::pair<bool, size_t> min_child_or_gchild(const DataType* heap_array, size_t i, size_t right_index, Compare comp = Compare()){
+        auto m = min_child(heap_array, i, right_index, comp);
         if(m.first){
-            auto  gm = min_gchild(heap_array, i, right_index);
-            m.second = gm.first && heap_array[gm.second] < heap_array[m.second] ? gm.second : m.second;
+            auto  gm = min_gchild(heap_array, i, right_index, comp);
+            m.second = gm.first && comp(heap_array[gm.second], heap_array[m.second]) ? gm.second : m.second;
         }
         return m;
     }
@@ -195,16 +211,21 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return  a pair where the first element is `true` if `i` has children (`false`
      *          otherwise), and the second element is the index of the child whose value
      *          is largest (only if the first element is `true`)
      */
-    template <typename DataType>
-    std::pair<bool, size_t> max_child(DataType* heap_array, size_t i, size_t right_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    std::pair<bool, size_t> max_child(const DataType* heap_array, size_t i, size_t right_index, Compare comp = Compare()){
         std::pair<bool, size_t> result {false, 0};
         if(left(i) <= right_index){
             auto m = left(i);
-            if(right(i) <= right_index && heap_array[m] < heap_array[right(i)]){
+            if(right(i) <= right_index && comp(heap_array[m], heap_array[right(i)])){
                 m = right(i);
             }
             result = {true, m};
@@ -222,24 +243,29 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return  a pair where the first element is `true` if `i` has grandchildren
      *          (`false` otherwise), and the second element is the index of the
      *          grandchild whose value is largest (only if the first element is `true`)
      */
-    template <typename DataType>
-    std::pair<bool, size_t> max_gchild(DataType* heap_array, size_t i, size_t right_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    std::pair<bool, size_t> max_gchild(const DataType* heap_array, size_t i, size_t right_index, Compare comp = Compare()){
         std::pair<bool, size_t> result{false, 0};
         auto l = left(i);
         auto r = right(i);
         if(left(l) <= right_index){
             auto m = left(l);
-            if(right(l) <= right_index && heap_array[m] < heap_array[right(l)]){
+            if(right(l) <= right_index && comp(heap_array[m], heap_array[right(l)])){
                 m = right(l);
             }
-            if(left(r) <= right_index && heap_array[m] < heap_array[left(r)]){
+            if(left(r) <= right_index && comp(heap_array[m], heap_array[left(r)])){
                 m = left(r);
             }
-            if(right(r) <= right_index && heap_array[m] < heap_array[right(r)]){
+            if(right(r) <= right_index && comp(heap_array[m], heap_array[right(r)])){
                 m = right(r);
             }
             result = {true, m};
@@ -257,17 +283,22 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return  a pair where the first element is `true` if `i` has children
      *          (`false` otherwise), and the second element is the index of the
      *          child or grandchild whose value is largest (only if the first
      *          element is `true`)
      */
-    template <typename DataType>
-    std::pair<bool, size_t> max_child_or_gchild(DataType* heap_array, size_t i, size_t right_index){
-        auto m = max_child(heap_array, i, right_index);
+    template <typename DataType, typename Compare = std::less<DataType>>
+    std::pair<bool, size_t> max_child_or_gchild(const DataType* heap_array, size_t i, size_t right_index, Compare comp = Compare()){
+        auto m = max_child(heap_array, i, right_index, comp);
         if(m.first){
-            auto gm  = max_gchild(heap_array, i, right_index);
-            m.second = gm.first &&  heap_array[m.second] < heap_array[gm.second] ? gm.second : m.second;
+            auto gm  = max_gchild(heap_array, i, right_index, comp);
+            m.second = gm.first &&  comp(heap_array[m.second], heap_array[gm.second]) ? gm.second : m.second;
         }
         return m;
     }
@@ -281,23 +312,28 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      */
-    template <typename DataType>
-    void sift_down_min(DataType* heap_array, size_t sift_index, size_t right_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    void sift_down_min(DataType* heap_array, size_t sift_index, size_t right_index, Compare comp = Compare()){
         bool sift_more = true;
         while(sift_more && left(sift_index) <= right_index){                            // if a[i] has children
             sift_more = false;
-            auto mp = min_child_or_gchild(heap_array, sift_index, right_index);         // get min child or grandchild
+            auto mp = min_child_or_gchild(heap_array, sift_index, right_index, comp);   // get min child or grandchild
             auto m  = mp.second;
             if(child(sift_index, m)){                                                   // if the min was a child
-                if(heap_array[m] < heap_array[sift_index]){
+                if(comp(heap_array[m], heap_array[sift_index])){
                     std::swap(heap_array[m], heap_array[sift_index]);
                 }
             }
             else{                                                                       // min was a grandchild
-                if(heap_array[m] < heap_array[sift_index]){
+                if(comp(heap_array[m], heap_array[sift_index])){
                     std::swap(heap_array[m], heap_array[sift_index]);
-                    if(heap_array[parent(m)] < heap_array[m]){
+                    if(comp(heap_array[parent(m)], heap_array[m])){
                         std::swap(heap_array[m], heap_array[parent(m)]);
                     }
                     sift_index = m;
@@ -316,23 +352,28 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      */
-    template <typename DataType>
-    void sift_down_max(DataType* heap_array, size_t sift_index, size_t right_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    void sift_down_max(DataType* heap_array, size_t sift_index, size_t right_index, Compare comp = Compare()){
         bool sift_more = true;
         while(sift_more && left(sift_index) <= right_index){                            // if a[i] has children
             sift_more = false;
-            auto mp = max_child_or_gchild(heap_array, sift_index, right_index);         // get max child or grandchild
+            auto mp = max_child_or_gchild(heap_array, sift_index, right_index, comp);   // get max child or grandchild
             auto m  = mp.second;
             if(child(sift_index, m)){                                                   // if the max was a child
-                if(heap_array[sift_index] < heap_array[m]){
+                if(comp(heap_array[sift_index], heap_array[m])){
                     std::swap(heap_array[m], heap_array[sift_index]);
                 }
             }
             else{                                                                       // max was a grandchild
-                if(heap_array[sift_index] < heap_array[m]){
+                if(comp(heap_array[sift_index], heap_array[m])){
                     std::swap(heap_array[m], heap_array[sift_index]);
-                    if(heap_array[m] < heap_array[parent(m)]){
+                    if(comp(heap_array[m], heap_array[parent(m)])){
                         std::swap(heap_array[m], heap_array[parent(m)]);
                     }
                     sift_index = m;
@@ -351,14 +392,19 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      */
-    template <typename DataType>
-    void sift_down(DataType* heap_array, size_t sift_index, size_t right_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    void sift_down(DataType* heap_array, size_t sift_index, size_t right_index, Compare comp = Compare()){
         if(min_level(sift_index)){
-            sift_down_min(heap_array, sift_index, right_index);
+            sift_down_min(heap_array, sift_index, right_index, comp);
         }
         else{
-            sift_down_max(heap_array, sift_index, right_index);
+            sift_down_max(heap_array, sift_index, right_index, comp);
         }
     }
 
@@ -370,13 +416,18 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      */
-    template <typename DataType>
-    void bubble_up_min(DataType* heap_array, size_t bubble_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    void bubble_up_min(DataType* heap_array, size_t bubble_index, Compare comp = Compare()){
         bool finished = false;
         while(!finished && has_gparent(bubble_index)){
             finished = true;
-            if(heap_array[bubble_index] < heap_array[gparent(bubble_index)]){
+            if(comp(heap_array[bubble_index], heap_array[gparent(bubble_index)])){
                 std::swap(heap_array[bubble_index], heap_array[gparent(bubble_index)]);
                 bubble_index = gparent(bubble_index);
                 finished     = false;
@@ -392,13 +443,18 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      */
-    template <typename DataType>
-    void bubble_up_max(DataType* heap_array, size_t bubble_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    void bubble_up_max(DataType* heap_array, size_t bubble_index, Compare comp = Compare()){
         bool finished = false;
         while(!finished && has_gparent(bubble_index)){
             finished = true;
-            if(heap_array[gparent(bubble_index)] < heap_array[bubble_index]){
+            if(comp(heap_array[gparent(bubble_index)], heap_array[bubble_index])){
                 std::swap(heap_array[bubble_index], heap_array[gparent(bubble_index)]);
                 bubble_index = gparent(bubble_index);
                 finished     = false;
@@ -414,25 +470,30 @@ namespace _mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      */
-    template <typename DataType>
-    void bubble_up(DataType* heap_array, size_t bubble_index){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    void bubble_up(DataType* heap_array, size_t bubble_index, Compare comp = Compare()){
         if(min_level(bubble_index)){
-            if(has_parent(bubble_index) && heap_array[parent(bubble_index)] < heap_array[bubble_index]){
+            if(has_parent(bubble_index) && comp(heap_array[parent(bubble_index)], heap_array[bubble_index])){
                 std::swap(heap_array[bubble_index], heap_array[parent(bubble_index)]);
-                bubble_up_max(heap_array, parent(bubble_index));
+                bubble_up_max(heap_array, parent(bubble_index), comp);
             }
             else{
-                bubble_up_min(heap_array, bubble_index);
+                bubble_up_min(heap_array, bubble_index, comp);
             }
         }
         else{
-            if(has_parent(bubble_index) && heap_array[bubble_index] < heap_array[parent(bubble_index)]){
+            if(has_parent(bubble_index) && comp(heap_array[bubble_index], heap_array[parent(bubble_index)])){
                 std::swap(heap_array[bubble_index], heap_array[parent(bubble_index)]);
-                bubble_up_min(heap_array, parent(bubble_index));
+                bubble_up_min(heap_array, parent(bubble_index), comp);
             }
             else{
-                bubble_up_max(heap_array, bubble_index);
+                bubble_up_max(heap_array, bubble_index, comp);
             }
         }
     }
@@ -444,6 +505,11 @@ namespace _mmheap{
  * is in this namespace.
  */
 namespace mmheap{
+    // Every function below takes an optional trailing comparison function object
+    // (`std::less<DataType>` by default), so a heap may be ordered by any strict
+    // weak ordering -- e.g. `std::greater<DataType>` makes the "min" end hold the
+    // largest value.  A stateless comparator compiles to the same code as `<`.
+
     /**
      * @brief   make an arbitrary array into a heap (in-place)
      * @details Applies Floyd's algorithm (adapted to a min-max heap) to produce
@@ -454,13 +520,18 @@ namespace mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      */
-    template <typename DataType>
-    void make_heap(DataType* heap_array, size_t size){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    void make_heap(DataType* heap_array, size_t size, Compare comp = Compare()){
         if(size > 1){
             bool finished = false;
             for(size_t current = _mmheap::parent(size-1); !finished; --current){
-                _mmheap::sift_down(heap_array, current, size-1);
+                _mmheap::sift_down(heap_array, current, size-1, comp);
                 finished = current == 0;
             }
         }
@@ -476,13 +547,39 @@ namespace mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
+     * @throws std::runtime_error if the heap is full prior to the insert operation
+     */
+    template <typename DataType, typename Compare = std::less<DataType>>
+    void heap_insert(const DataType& value, DataType* heap_array, size_t& count, size_t max_size, Compare comp = Compare()){
+        heap_insert(DataType(value), heap_array, count, max_size, comp);
+    }
+
+    /**
+     * insert a new value to the heap (and update the `count`), moving it into place
+     *
+     * @param           value       the new value to insert (left in a moved-from state)
+     * @param           heap_array  the heap
+     * @param[in,out]   count       the current number of items in the heap (will update)
+     * @param           max_size    the physical storage allocation size of the heap
+     * @tparam  DataType    the type of data stored in the heap - must be
+     *                      LessThanComparable, Swappable, and MoveAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @throws std::runtime_error if the heap is full prior to the insert operation
      */
-    template <typename DataType>
-    void heap_insert(const DataType& value, DataType* heap_array, size_t& count, size_t max_size){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    void heap_insert(DataType&& value, DataType* heap_array, size_t& count, size_t max_size, Compare comp = Compare()){
         if(count < max_size){
-            heap_array[count++] = value;
-            _mmheap::bubble_up(heap_array, count-1);
+            heap_array[count++] = std::move(value);
+            _mmheap::bubble_up(heap_array, count-1, comp);
         }
         else{
             throw std::runtime_error("Cannot insert into heap - allocated size is full.");
@@ -497,15 +594,20 @@ namespace mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
-     * @return the maximum value in the heap
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
+     * @return a reference to the maximum value in the heap
      * @throws std::runtime_error if the heap is empty
      */
-    template <typename DataType>
-    DataType heap_max(DataType* heap_array, size_t count){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    const DataType& heap_max(const DataType* heap_array, size_t count, Compare comp = Compare()){
         if(count < 1){
             throw std::runtime_error("Cannot get max value in empty heap.");
         }
-        auto m = _mmheap::max_child(heap_array, 0, count-1);
+        auto m = _mmheap::max_child(heap_array, 0, count-1, comp);
         return m.first ? heap_array[m.second] : heap_array[0];
     }
 
@@ -517,11 +619,16 @@ namespace mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
-     * @return the minimum value in the heap
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
+     * @return a reference to the minimum value in the heap
      * @throws std::runtime_error if the heap is empty
      */
-    template <typename DataType>
-    DataType heap_min(DataType* heap_array, size_t count){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    const DataType& heap_min(const DataType* heap_array, size_t count, Compare = Compare()){
         if(count < 1){
             throw std::runtime_error("Cannot get min value in empty heap.");
         }
@@ -533,89 +640,100 @@ namespace mmheap{
      * @details Add to the min-max heap in such a way that the maximum value is removed
      *          at the same time if the heap has reached its storage capacity.
      *
-     * @param         value         new value to add
+     * @param         value         new value to add (taken by value, so pass an rvalue
+     *                              to move it all the way into place)
      * @param         heap_array    the heap
      * @param[in,out] count         number of values currently in the heap (will update)
      * @param         max_size      maximum physical size allocated for the heap
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      DefaultConstructable, LessThanComparable, Swappable,
-     *                      CopyConstructable, and CopyAssignable
+     *                      and MoveAssignable (values are moved, never copied)
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return a pair consising of a flag and a value; the first element is a flag
      *         indicating that overflow occurred, and the second element is the value
      *         that rotated out of the heap (formerly the maximum) when the new value
      *         was added (set only if an overflow occurred)
      */
-    template <typename DataType>
-    std::pair<bool, DataType> heap_insert_circular(const DataType& value, DataType* heap_array, size_t& count, size_t max_size){
-        auto max_value  = DataType{};
-        bool overflowed = count == max_size ? true : false;
-        if(!overflowed){
-            heap_insert(value, heap_array, count, max_size);
+    template <typename DataType, typename Compare = std::less<DataType>>
+    std::pair<bool, DataType> heap_insert_circular(DataType value, DataType* heap_array, size_t& count, size_t max_size, Compare comp = Compare()){
+        std::pair<bool, DataType> result{count == max_size, DataType{}};     // (overflowed, value rotated out)
+        if(!result.first){
+            heap_insert(std::move(value), heap_array, count, max_size, comp);
         }
         else{                                                   // if the heap is full, replace the max value with the new add...
-            auto m        = max_size > 1 ? _mmheap::max_child(heap_array, 0, max_size-1).second : 0;
-            max_value     = heap_array[m];
-            if(value < max_value){                                  // if the new value is larger than the one rotating out, just rotate the new value
-                heap_array[m] = value;
+            auto m        = max_size > 1 ? _mmheap::max_child(heap_array, 0, max_size-1, comp).second : 0;
+            if(comp(value, heap_array[m])){                         // if the new value is larger than the one rotating out, just rotate the new value
+                result.second = std::move(heap_array[m]);
+                heap_array[m] = std::move(value);
                 if(max_size > 1){                                   // if this is non-trivial
-                    if(value < heap_array[0]){                      // check that the new value isn't the new min
+                    if(comp(heap_array[m], heap_array[0])){         // check that the new value isn't the new min
                         std::swap(heap_array[0], heap_array[m]);    //  (if it is, make it so)
                     }
-                    _mmheap::sift_down(heap_array, m, max_size-1);  // sift the new item down
+                    _mmheap::sift_down(heap_array, m, max_size-1, comp); // sift the new item down
                 }
             }
             else{
-                max_value = value;
+                result.second = std::move(value);
             }
         }
-        return std::pair<bool, DataType>{overflowed, max_value};
+        return result;
     }
 
 
     /**
      * replace and return the value at a given index with a new value
      *
-     * @param new_value   new value to insert
+     * @param new_value   new value to insert (taken by value, so pass an rvalue to move it into place)
      * @param index       index of the value to replace
      * @param heap_array  the heap
      * @param count       number of values currently stored in the heap
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return  the old value being replaced
      * @throws  std::runtime_error if the heap is empty
      * @throws  std::range_error   if the index is out of range
      */
-    template <typename DataType>
-    DataType heap_replace_at_index(const DataType& new_value, size_t index, DataType* heap_array, size_t count){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    DataType heap_replace_at_index(DataType new_value, size_t index, DataType* heap_array, size_t count, Compare comp = Compare()){
         if(count == 0){
             throw std::runtime_error("Cannot replace value in empty heap.");
         }
         if(index > count){
             throw std::range_error("Index beyond end of heap.");
         }
-        auto old_value    = heap_array[index];
-        heap_array[index] = new_value;
+        auto old_value    = std::move(heap_array[index]);
+        heap_array[index] = std::move(new_value);
+        const auto& value = heap_array[index];                 // (only read before anything moves out of `index`)
         if(_mmheap::min_level(index)){
-            if(new_value < old_value){
-                _mmheap::bubble_up_min(heap_array, index);
+            if(comp(value, old_value)){
+                _mmheap::bubble_up_min(heap_array, index, comp);
             }
             else{
-                if(_mmheap::has_parent(index) && heap_array[_mmheap::parent(index)] < new_value){
-                    _mmheap::bubble_up(heap_array, index);
+                if(_mmheap::has_parent(index) && comp(heap_array[_mmheap::parent(index)], value)){
+                    _mmheap::bubble_up(heap_array, index, comp);
                 }
-                _mmheap::sift_down(heap_array, index, count-1);
+                _mmheap::sift_down(heap_array, index, count-1, comp);
             }
         }
         else{
-            if(old_value < new_value){
-                _mmheap::bubble_up_max(heap_array, index);
+            if(comp(old_value, value)){
+                _mmheap::bubble_up_max(heap_array, index, comp);
             }
             else{
-                if(_mmheap::has_parent(index) && new_value < heap_array[_mmheap::parent(index)]){
-                    _mmheap::bubble_up(heap_array, index);
+                if(_mmheap::has_parent(index) && comp(value, heap_array[_mmheap::parent(index)])){
+                    _mmheap::bubble_up(heap_array, index, comp);
                 }
-                _mmheap::sift_down(heap_array, index, count-1);
+                _mmheap::sift_down(heap_array, index, count-1, comp);
             }
         }
         return old_value;
@@ -630,21 +748,28 @@ namespace mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return  the value being removed
      * @throws  std::runtime_error if the heap is empty
      * @throws  std::range_error   if the index is out of range
      */
-    template <typename DataType>
-    DataType heap_remove_at_index(size_t index, DataType* heap_array, size_t& count){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    DataType heap_remove_at_index(size_t index, DataType* heap_array, size_t& count, Compare comp = Compare()){
         if(count == 0){
             throw std::runtime_error("Cannot remove value in empty heap.");
         }
         if(index > count){
             throw std::range_error("Index beyond end of heap.");
         }
-        auto old_value = heap_replace_at_index(heap_array[count-1], index, heap_array, count);
         --count;
-        return old_value;
+        if(index == count){                                     // removing the last value needs no re-heap
+            return std::move(heap_array[count]);
+        }
+        return heap_replace_at_index(std::move(heap_array[count]), index, heap_array, count, comp);
     }
 
     /**
@@ -655,19 +780,24 @@ namespace mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return the minimum value in the heap
      * @throws std::runtime_error if the heap is empty
      */
-    template <typename DataType>
-    DataType heap_remove_min(DataType* heap_array, size_t& count){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    DataType heap_remove_min(DataType* heap_array, size_t& count, Compare comp = Compare()){
         if(count == 0){
             throw std::runtime_error("Cannot remove from empty heap.");
         }
-        auto value = heap_array[0];
-        std::swap(heap_array[0], heap_array[count-1]);
+        auto value = std::move(heap_array[0]);
         --count;
         if(count > 0){
-            _mmheap::sift_down(heap_array, 0, count-1);
+            heap_array[0] = std::move(heap_array[count]);
+            _mmheap::sift_down(heap_array, 0, count-1, comp);
         }
         return value;
     }
@@ -680,24 +810,21 @@ namespace mmheap{
      * @tparam  DataType    the type of data stored in the heap - must be
      *                      LessThanComparable, Swappable, CopyConstructable,
      *                      and CopyAssignable
+     * @tparam  Compare     the type of the function object that orders the values
+     *                      (`std::less<DataType>` by default); `comp(x, y)` must
+     *                      induce a strict weak ordering, as for the standard algorithms
+     * @param   comp        the comparison function object (default-constructed if
+     *                      not given)
      * @return the maximum value in the heap
      * @throws std::runtime_error if the heap is empty
      */
-    template <typename DataType>
-    DataType heap_remove_max(DataType* heap_array, size_t& count){
+    template <typename DataType, typename Compare = std::less<DataType>>
+    DataType heap_remove_max(DataType* heap_array, size_t& count, Compare comp = Compare()){
         if(count == 0){
             throw std::runtime_error("Cannot remove from empty heap.");
         }
-        auto value = heap_array[0];
-        auto m     = _mmheap::max_child(heap_array, 0, count-1);
-        if(m.first){
-            value = heap_array[m.second];
-        }
-        else{
-            m.second = 0;
-        }
-        heap_remove_at_index(m.second, heap_array, count);
-        return value;
+        auto m = _mmheap::max_child(heap_array, 0, count-1, comp);
+        return heap_remove_at_index(m.first ? m.second : 0, heap_array, count, comp);
     }
 }
 
@@ -0,0 +1,351 @@
+#ifndef PARTITION_SCAN_H
+#define PARTITION_SCAN_H
+/**
+ * @file partition_scan.h
+ *
+ * Defines the linear scan used to search inside a single HeapArray partition.
+ * For arithmetic types with 4- or 8-byte elements, the scan compares several
+ * lanes at a time using whichever vector instruction set the compiler is
+ * targeting (AVX-512, AVX2, SSE2, or NEON); other types (and targets without
+ * any of those extensions) use a plain scalar loop.  The instruction set is
+ * chosen at compile time, so build with e.g. `-march=native` to get the
+ * widest lanes available.
+ *
+ * @details
+ *   Everything here lives in the `_heaparray` namespace, which (like `_mmheap`)
+ *   contains functions that are only intended for internal use.
+ *
+ * @author    Jason L Causey
+ * @license   Released under the MIT License: http://opensource.org/licenses/MIT
+ * @copyright Copyright (c) 2015 Jason L Causey, Arkansas State University
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+/**
+ * The `_heaparray` namespace contains functions that are only intended for internal
+ * use by the HeapArray.  None of the functions in `_heaparray::` should be necessary
+ * externally.
+ */
+namespace _heaparray{
+
+    /**
+     * Indicates whether `DataType` can be searched with the vectorized scan:
+     * arithmetic types (other than `bool`) with 4- or 8-byte elements.
+     */
+    template <typename DataType>
+    struct simd_scannable : std::integral_constant<bool,
+        std::is_arithmetic<DataType>::value && !std::is_same<DataType, bool>::value
+        && (sizeof(DataType) == 4 || sizeof(DataType) == 8)>{};
+
+    /**
+     * Indicates whether `Equal` is plain `operator==` on `DataType` (and so may be
+     * replaced by a bitwise/vector comparison).
+     */
+    template <typename DataType, typename Equal>
+    struct is_default_equal : std::integral_constant<bool,
+        std::is_same<Equal, std::equal_to<DataType>>::value || std::is_same<Equal, std::equal_to<>>::value>{};
+
+    /*
+     * index of the lowest set bit in a non-zero mask
+     */
+    inline unsigned lowest_bit(uint64_t mask){
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(mask));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        unsigned index = 0;                                                             // (the mask is at most 16 bits wide, so
+        while(!(mask & 1)){                                                             // a loop is cheap)
+            mask >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    /**
+     * find the first element equal to `value` in `first[0..n)` using a scalar loop
+     *
+     * @param  first  pointer to the first element to examine
+     * @param  n      number of elements to examine
+     * @param  value  the value to search for
+     * @param  equal  the equality function object
+     * @tparam DataType  the type of data being searched
+     * @tparam Equal     the type of the equality function object
+     * @return the offset of the first match, or `n` if there is none
+     */
+    template <typename DataType, typename Equal = std::equal_to<DataType>>
+    size_t find_equal_scalar(const DataType* first, size_t n, const DataType& value, Equal equal = Equal()){
+        size_t i = 0;
+        while(i < n && !equal(first[i], value)){
+            ++i;
+        }
+        return i;
+    }
+
+    /*
+     * Vectorized scan for 4-byte integers; returns an offset at or before the first match
+     * (every element before it is known not to match), or the start of the scalar tail.
+     */
+    inline size_t skip_unequal_32i(const void* data, size_t n, int32_t value){
+        auto   first = static_cast<const int32_t*>(data);
+        size_t i     = 0;
+#if defined(__AVX512F__)
+        const __m512i needle = _mm512_set1_epi32(value);
+        for(; i + 16 <= n; i += 16){
+            __mmask16 hits = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(first + i), needle);
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__AVX2__)
+        const __m256i needle = _mm256_set1_epi32(value);
+        for(; i + 8 <= n; i += 8){
+            __m256i  block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + i));
+            unsigned hits  = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(block, needle)));
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128i needle = _mm_set1_epi32(value);
+        for(; i + 4 <= n; i += 4){
+            __m128i  block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+            unsigned hits  = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, needle)));
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__ARM_NEON)
+        const int32x4_t needle = vdupq_n_s32(value);
+        for(; i + 4 <= n; i += 4){
+            uint32x4_t eq = vceqq_s32(vld1q_s32(first + i), needle);
+            if(vgetq_lane_u64(vreinterpretq_u64_u32(eq), 0) | vgetq_lane_u64(vreinterpretq_u64_u32(eq), 1)){
+                break;                                                                  // the scalar tail locates the lane
+            }
+        }
+#else
+        (void)first, (void)n, (void)value;                                             // no vector extension: all scalar
+#endif
+        return i;
+    }
+
+    /*
+     * Vectorized scan for 8-byte integers; returns an offset at or before the first match
+     * (every element before it is known not to match), or the start of the scalar tail.
+     */
+    inline size_t skip_unequal_64i(const void* data, size_t n, int64_t value){
+        auto   first = static_cast<const int64_t*>(data);
+        size_t i     = 0;
+#if defined(__AVX512F__)
+        const __m512i needle = _mm512_set1_epi64(value);
+        for(; i + 8 <= n; i += 8){
+            __mmask8 hits = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(first + i), needle);
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__AVX2__)
+        const __m256i needle = _mm256_set1_epi64x(value);
+        for(; i + 4 <= n; i += 4){
+            __m256i  block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + i));
+            unsigned hits  = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(block, needle)));
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128i needle = _mm_set1_epi64x(value);
+        for(; i + 2 <= n; i += 2){                                                      // SSE2 has no 64-bit compare: both 32-bit
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));   // halves of a lane have to be equal
+            __m128i eq    = _mm_cmpeq_epi32(block, needle);
+            eq            = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+            unsigned hits = _mm_movemask_pd(_mm_castsi128_pd(eq));
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const int64x2_t needle = vdupq_n_s64(value);
+        for(; i + 2 <= n; i += 2){
+            uint64x2_t eq = vceqq_s64(vld1q_s64(first + i), needle);
+            if(vgetq_lane_u64(eq, 0) | vgetq_lane_u64(eq, 1)){
+                break;                                                                  // the scalar tail locates the lane
+            }
+        }
+#else
+        (void)first, (void)n, (void)value;                                             // no vector extension: all scalar
+#endif
+        return i;
+    }
+
+    /*
+     * Vectorized scan for `float`; returns an offset at or before the first match
+     * (every element before it is known not to match), or the start of the scalar tail.
+     * Uses ordered equality, so (like `==`) NaN never matches and -0.0 matches 0.0.
+     */
+    inline size_t skip_unequal_32f(const void* data, size_t n, float value){
+        auto   first = static_cast<const float*>(data);
+        size_t i     = 0;
+#if defined(__AVX512F__)
+        const __m512 needle = _mm512_set1_ps(value);
+        for(; i + 16 <= n; i += 16){
+            __mmask16 hits = _mm512_cmp_ps_mask(_mm512_loadu_ps(first + i), needle, _CMP_EQ_OQ);
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__AVX2__)
+        const __m256 needle = _mm256_set1_ps(value);
+        for(; i + 8 <= n; i += 8){
+            unsigned hits = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(first + i), needle, _CMP_EQ_OQ));
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128 needle = _mm_set1_ps(value);
+        for(; i + 4 <= n; i += 4){
+            unsigned hits = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(first + i), needle));
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__ARM_NEON)
+        const float32x4_t needle = vdupq_n_f32(value);
+        for(; i + 4 <= n; i += 4){
+            uint32x4_t eq = vceqq_f32(vld1q_f32(first + i), needle);
+            if(vgetq_lane_u64(vreinterpretq_u64_u32(eq), 0) | vgetq_lane_u64(vreinterpretq_u64_u32(eq), 1)){
+                break;                                                                  // the scalar tail locates the lane
+            }
+        }
+#else
+        (void)first, (void)n, (void)value;                                             // no vector extension: all scalar
+#endif
+        return i;
+    }
+
+    /*
+     * Vectorized scan for `double`; returns an offset at or before the first match
+     * (every element before it is known not to match), or the start of the scalar tail.
+     * Uses ordered equality, so (like `==`) NaN never matches and -0.0 matches 0.0.
+     */
+    inline size_t skip_unequal_64f(const void* data, size_t n, double value){
+        auto   first = static_cast<const double*>(data);
+        size_t i     = 0;
+#if defined(__AVX512F__)
+        const __m512d needle = _mm512_set1_pd(value);
+        for(; i + 8 <= n; i += 8){
+            __mmask8 hits = _mm512_cmp_pd_mask(_mm512_loadu_pd(first + i), needle, _CMP_EQ_OQ);
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__AVX2__)
+        const __m256d needle = _mm256_set1_pd(value);
+        for(; i + 4 <= n; i += 4){
+            unsigned hits = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(first + i), needle, _CMP_EQ_OQ));
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128d needle = _mm_set1_pd(value);
+        for(; i + 2 <= n; i += 2){
+            unsigned hits = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(first + i), needle));
+            if(hits){
+                return i + lowest_bit(hits);
+            }
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const float64x2_t needle = vdupq_n_f64(value);
+        for(; i + 2 <= n; i += 2){
+            uint64x2_t eq = vceqq_f64(vld1q_f64(first + i), needle);
+            if(vgetq_lane_u64(eq, 0) | vgetq_lane_u64(eq, 1)){
+                break;                                                                  // the scalar tail locates the lane
+            }
+        }
+#else
+        (void)first, (void)n, (void)value;                                             // no vector extension: all scalar
+#endif
+        return i;
+    }
+
+    /**
+     * @brief   find the first element equal to `value` in `first[0..n)`
+     * @details Dispatches (at compile time) to a vectorized scan when `DataType` is
+     *          a 4- or 8-byte arithmetic type compared with plain `==`, and to a
+     *          scalar loop otherwise (including any user-supplied `Equal`).
+     *
+     * @param  first  pointer to the first element to examine
+     * @param  n      number of elements to examine
+     * @param  value  the value to search for
+     * @param  equal  the equality function object
+     * @tparam DataType  the type of data being searched
+     * @tparam Equal     the type of the equality function object
+     * @return the offset of the first match, or `n` if there is none
+     */
+    template <typename DataType, typename Equal = std::equal_to<DataType>>
+    size_t find_equal(const DataType* first, size_t n, const DataType& value, Equal equal = Equal()){
+        size_t i = 0;                                                                   // the vector scans skip ahead to (at most)
+        if constexpr(!simd_scannable<DataType>::value                                   // the first match, and the scalar loop
+                     || !is_default_equal<DataType, Equal>::value){                     // finishes from there
+            i = 0;
+        }
+        else if constexpr(std::is_floating_point<DataType>::value){
+            if constexpr(sizeof(DataType) == 4){
+                i = skip_unequal_32f(first, n, value);
+            }
+            else{
+                i = skip_unequal_64f(first, n, value);
+            }
+        }
+        else if constexpr(sizeof(DataType) == 4){                                     // integer equality doesn't care about
+            int32_t needle;                                                             // signedness, so just compare the bits
+            std::memcpy(&needle, &value, sizeof needle);
+            i = skip_unequal_32i(first, n, needle);
+        }
+        else{
+            int64_t needle;
+            std::memcpy(&needle, &value, sizeof needle);
+            i = skip_unequal_64i(first, n, needle);
+        }
+        return i + find_equal_scalar(first + i, n - i, value, equal);
+    }
+}
+
+#endif
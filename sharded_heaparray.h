@@ -0,0 +1,399 @@
+#ifndef SHARDED_HEAPARRAY_H
+#define SHARDED_HEAPARRAY_H
+/**
+ * @file sharded_heaparray.h
+ *
+ * Defines the ShardedHeapArray, a set of independent HeapArrays ("shards"), each
+ * with its own lock, that values are spread across by hash.  Threads working in
+ * different shards never wait for each other, and each shard holds only
+ * 1/Shards of the values, so its sqrt(n)-time operations work on a smaller n.
+ *
+ *
+ * @author    Jason L Causey
+ * @license   Released under the MIT License: http://opensource.org/licenses/MIT
+ * @copyright Copyright (c) 2015 Jason L Causey, Arkansas State University
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include "heaparray.h"
+
+/**
+ * @brief   A HeapArray split into independently locked shards, for many cores.
+ * @details Each value belongs to the shard chosen by its hash (so `Hash` must agree with
+ *          `Equal`: values that match must hash alike), and every operation on one value
+ *          locks and works in that shard only.  With one ingest thread per core, threads
+ *          only meet when their values land in the same shard, and each shard's
+ *          operations scale with the square root of its own size.
+ *
+ *          Hashing spreads values evenly whatever their distribution, but means any
+ *          shard can hold any value, so order queries combine the shards: `min()` and
+ *          `max()` compare the extremes of every shard (each is O(1) in its HeapArray,
+ *          and there are only `Shards` of them), and iteration merges the shards in
+ *          ascending order.
+ *
+ * @tparam  DataType    the type of data stored - same requirements as the `DataType`
+ *                      of a HeapArray
+ * @tparam  Shards      the number of shards (typically the number of cores)
+ * @tparam  Compare     the type of the function object that orders the values
+ *                      (`std::less<DataType>` by default)
+ * @tparam  Equal       the type of the function object used to match values in
+ *                      searches (`std::equal_to<DataType>` by default)
+ * @tparam  Hash        the type of the function object that picks each value's shard
+ *                      (`std::hash<DataType>` by default)
+ */
+template <typename DataType, size_t Shards = 8, typename Compare = std::less<DataType>, typename Equal = std::equal_to<DataType>,
+          typename Hash = std::hash<DataType>>
+class ShardedHeapArray{
+    static_assert(Shards > 0, "A ShardedHeapArray needs at least one shard.");
+
+protected:
+    struct alignas(64) shard{                                                                       // (one per cache line)
+        mutable std::mutex                      lock;
+        HeapArray<DataType, Compare, Equal>     heap;
+        std::atomic<size_t>                     count{0};                                           // `heap.size()`, readable without the lock
+    };
+
+public:
+    class const_iterator;
+
+    explicit ShardedHeapArray(const Compare& compare = Compare(), const Equal& equality = Equal(), const Hash& hash = Hash());
+    ShardedHeapArray(const ShardedHeapArray&) = delete;
+    ShardedHeapArray& operator=(const ShardedHeapArray&) = delete;
+
+    void                    insert(const DataType& value);
+    void                    insert(DataType&& value);
+    template <typename ForwardIterator>
+    void                    insert_bulk(ForwardIterator first, ForwardIterator last);
+    bool                    remove(const DataType& value);
+    bool                    contains(const DataType& value)const;
+    DataType                min()const;
+    DataType                max()const;
+    size_t                  size()const;
+    bool                    empty()const;
+    size_t                  shard_of(const DataType& value)const;
+    const_iterator          begin()const;
+    const_iterator          end()const;
+
+protected:
+    template <typename Extreme>
+    DataType                _extreme(Extreme extreme, bool want_max)const;
+
+    Compare                 comp;                                                                   // orders the values
+    Hash                    hash;                                                                   // picks each value's shard
+    shard                   shards[Shards];
+};
+
+/**
+ * @brief   Iterates over the values of a ShardedHeapArray in ascending order.
+ * @details A k-way merge: each shard is read one partition at a time (partitions are
+ *          ordered, so sorting a copy of the current one yields the shard's next run of
+ *          values), and a small heap of shard cursors picks the smallest next value.
+ *          Work and memory per step are bounded by one partition per shard.
+ *
+ *          An input iterator.  Iteration reads the shards without locking them: no
+ *          thread may modify the ShardedHeapArray while it is being iterated.
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+class ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::const_iterator{
+public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef DataType                value_type;
+    typedef std::ptrdiff_t          difference_type;
+    typedef const DataType*         pointer;
+    typedef const DataType&         reference;
+
+    const_iterator() = default;
+    reference operator*()const{ return cursors[order.front()].run[cursors[order.front()].next]; }
+    pointer   operator->()const{ return &**this; }
+    const_iterator& operator++(){
+        std::pop_heap(order.begin(), order.end(), _later());
+        auto s = order.back();
+        order.pop_back();
+        if(_advance(s)){
+            order.push_back(s);
+            std::push_heap(order.begin(), order.end(), _later());
+        }
+        return *this;
+    }
+    const_iterator operator++(int){ auto old = *this; ++*this; return old; }
+    bool operator==(const const_iterator& rhs)const{ return order.empty() && rhs.order.empty(); } // (only the end is ever compared)
+    bool operator!=(const const_iterator& rhs)const{ return !(*this == rhs); }
+
+private:
+    friend class ShardedHeapArray;
+
+    struct cursor{
+        std::vector<DataType> run;                                                                  // the current partition, sorted
+        size_t                next      = 0;                                                        // the next value in `run`
+        size_t                partition = 0;                                                        // the partition after `run`'s
+    };
+
+    struct later{                                                                                   // (makes std::push_heap a min-heap)
+        const const_iterator* it;
+        bool operator()(size_t a, size_t b)const{
+            auto& ca = it->cursors[a];
+            auto& cb = it->cursors[b];
+            return it->owner->comp(cb.run[cb.next], ca.run[ca.next]);
+        }
+    };
+
+    explicit const_iterator(const ShardedHeapArray* o) : owner(o), cursors(Shards){
+        for(size_t s = 0; s < Shards; ++s){
+            if(_advance(s)){
+                order.push_back(s);
+            }
+        }
+        std::make_heap(order.begin(), order.end(), _later());
+    }
+
+    /*
+     * moves shard `s`'s cursor to its next value, loading the shard's next partition
+     * when the current one is used up; returns `false` once the shard is exhausted
+     */
+    bool _advance(size_t s){
+        auto& c = cursors[s];
+        if(!c.run.empty() && ++c.next < c.run.size()){
+            return true;
+        }
+        auto& heap  = owner->shards[s].heap;
+        auto  first = c.partition * c.partition;
+        if(first >= heap.size()){
+            return false;
+        }
+        auto last = std::min(heap.size(), first + 2 * c.partition + 1);
+        c.run.clear();
+        for(auto i = first; i < last; ++i){
+            c.run.push_back(heap[i]);
+        }
+        std::sort(c.run.begin(), c.run.end(), owner->comp);
+        c.next = 0;
+        ++c.partition;
+        return true;
+    }
+
+    later _later()const{ return {this}; }
+
+    const ShardedHeapArray* owner = nullptr;
+    std::vector<cursor>     cursors;
+    std::vector<size_t>     order;                                                                  // heap of shards with values left
+};
+
+/**
+ * Construct an empty ShardedHeapArray.
+ *
+ * @param compare   the comparison function object (default-constructed if not given)
+ * @param equality  the equality function object (default-constructed if not given)
+ * @param hash      the hash function object (default-constructed if not given)
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::ShardedHeapArray(const Compare& compare, const Equal& equality, const Hash& hash)
+    : comp(compare), hash(hash){
+    for(auto& s : shards){
+        s.heap = HeapArray<DataType, Compare, Equal>(compare, equality);
+    }
+}
+
+/**
+ * Insert a new item, locking only its shard.
+ * @param value  the value to insert
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+void ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::insert(const DataType& value){
+    auto& s = shards[shard_of(value)];
+    std::lock_guard<std::mutex> lock(s.lock);
+    s.heap.insert(value);
+    s.count.store(s.heap.size(), std::memory_order_relaxed);
+}
+
+/**
+ * Insert a new item by moving it, locking only its shard.
+ * @param value  the value to insert
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+void ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::insert(DataType&& value){
+    auto& s = shards[shard_of(value)];
+    std::lock_guard<std::mutex> lock(s.lock);
+    s.heap.insert(std::move(value));
+    s.count.store(s.heap.size(), std::memory_order_relaxed);
+}
+
+/**
+ * @brief   Insert a batch of new items.
+ * @details The batch is split by shard first, then each shard takes its part with one
+ *          `HeapArray::insert_bulk` under one acquisition of its lock.
+ *
+ * @param  first  iterator to the first value to insert
+ * @param  last   iterator to the position following the last value to insert
+ * @tparam ForwardIterator  an iterator type satisfying ForwardIterator, whose value
+ *                          type is assignable to `DataType`
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+template <typename ForwardIterator>
+void ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::insert_bulk(ForwardIterator first, ForwardIterator last){
+    std::vector<DataType> parts[Shards];
+    for(; first != last; ++first){
+        parts[shard_of(*first)].push_back(*first);
+    }
+    for(size_t i = 0; i < Shards; ++i){
+        if(!parts[i].empty()){
+            std::lock_guard<std::mutex> lock(shards[i].lock);
+            shards[i].heap.insert_bulk(parts[i].begin(), parts[i].end());
+            shards[i].count.store(shards[i].heap.size(), std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Remove one instance of a value, locking only its shard.
+ * @param  value  the value to remove
+ * @return `true` if `value` was found and removed
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+bool ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::remove(const DataType& value){
+    auto& s = shards[shard_of(value)];
+    std::lock_guard<std::mutex> lock(s.lock);
+    auto removed = s.heap.remove(value);
+    s.count.store(s.heap.size(), std::memory_order_relaxed);
+    return removed;
+}
+
+/**
+ * Is `value` present?  Searches (and locks) only its shard.
+ * @param  value  the value to search for
+ * @return `true` if it is
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+bool ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::contains(const DataType& value)const{
+    auto& s = shards[shard_of(value)];
+    std::lock_guard<std::mutex> lock(s.lock);
+    return s.heap.contains(value);
+}
+
+/**
+ * Get a copy of the minimum value (the least of the shards' minima).
+ * @return the minimum value
+ * @throws std::out_of_range if the ShardedHeapArray is empty
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+DataType ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::min()const{
+    return _extreme([](const HeapArray<DataType, Compare, Equal>& h) -> const DataType&{ return h.min(); }, false);
+}
+
+/**
+ * Get a copy of the maximum value (the greatest of the shards' maxima).
+ * @return the maximum value
+ * @throws std::out_of_range if the ShardedHeapArray is empty
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+DataType ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::max()const{
+    return _extreme([](const HeapArray<DataType, Compare, Equal>& h) -> const DataType&{ return h.max(); }, true);
+}
+
+/**
+ * Get the number of values stored (the sum of the shard sizes, read without locking).
+ * @return the number of values
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+size_t ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::size()const{
+    size_t total = 0;
+    for(auto& s : shards){
+        total += s.count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * Is the ShardedHeapArray empty?
+ * @return `true` if no shard holds a value
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+inline bool ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::empty()const{
+    return size() == 0;
+}
+
+/**
+ * Find the shard a value belongs to.  The hash is scrambled (Fibonacci hashing)
+ * before it is reduced, since `std::hash` is the identity for integers and
+ * would send regularly-spaced keys to the same few shards.
+ *
+ * @param  value  the value
+ * @return the index of its shard, in [0, Shards)
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+inline size_t ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::shard_of(const DataType& value)const{
+    return static_cast<size_t>((static_cast<uint64_t>(hash(value)) * UINT64_C(0x9E3779B97F4A7C15)) >> 32) % Shards;
+}
+
+/**
+ * Get an iterator to the smallest value (see `const_iterator`).
+ * @return the iterator
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+inline typename ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::const_iterator
+ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::begin()const{
+    return const_iterator(this);
+}
+
+/**
+ * Get the past-the-end iterator.
+ * @return the iterator
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+inline typename ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::const_iterator
+ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::end()const{
+    return const_iterator();
+}
+
+/*
+ * Finds the least (or with `want_max`, the greatest) of `extreme(heap)` over the
+ * non-empty shards, locking one shard at a time.
+ */
+template <typename DataType, size_t Shards, typename Compare, typename Equal, typename Hash>
+template <typename Extreme>
+DataType ShardedHeapArray<DataType, Shards, Compare, Equal, Hash>::_extreme(Extreme extreme, bool want_max)const{
+    std::optional<DataType> best;
+    for(auto& s : shards){
+        if(s.count.load(std::memory_order_relaxed) == 0){
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(s.lock);
+        if(s.heap.size() > 0){
+            auto& candidate = extreme(s.heap);
+            if(!best || (want_max ? comp(*best, candidate) : comp(candidate, *best))){
+                best = candidate;
+            }
+        }
+    }
+    if(!best){
+        throw std::out_of_range("ShardedHeapArray is empty.");
+    }
+    return *best;
+}
+
+#endif
@@ -0,0 +1,516 @@
+#ifndef SNAPSHOT_HEAPARRAY_H
+#define SNAPSHOT_HEAPARRAY_H
+/**
+ * @file snapshot_heaparray.h
+ *
+ * Defines the SnapshotHeapArray, a HeapArray for read-mostly workloads whose
+ * readers never take a lock.  Readers search an immutable version of the
+ * structure; writers build a new version (sharing every partition they did
+ * not change with the old one) and publish it with a single atomic store.  Old
+ * versions are reclaimed once no reader can still be using them (epoch-based
+ * reclamation, in the style of RCU).
+ *
+ *
+ * @author    Jason L Causey
+ * @license   Released under the MIT License: http://opensource.org/licenses/MIT
+ * @copyright Copyright (c) 2015 Jason L Causey, Arkansas State University
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "heaparray.h"
+
+/**
+ * @brief   A HeapArray whose readers never lock, for read-mostly workloads.
+ * @details The structure is kept as a sequence of immutable versions.  A version is a
+ *          list of partitions (each a separately allocated min-max heap, shared between
+ *          versions by reference count) plus a compact index of each partition's
+ *          maximum.  A writer builds the next version from the current one: the
+ *          partitions before the first one its update touches are shared, and only the
+ *          rest are rebuilt, after which the new version is published with one atomic
+ *          store.  Writers are serialized by a mutex.
+ *
+ *          Each reading thread registers once (`make_reader()`), getting a slot of its
+ *          own on its own cache line.  Opening a `view` writes the current epoch into that
+ *          slot and reads the current version; closing it clears the slot.  Readers
+ *          write nothing that any other thread reads often, and the shared data they read
+ *          (the version pointer, the epoch and the versions themselves) is only written
+ *          by writers, so readers add no cache-line contention of their own.  A writer
+ *          frees an old version only once every open view started after it was replaced.
+ *
+ * @tparam  DataType    the type of data stored - same requirements as the `DataType`
+ *                      of a HeapArray
+ * @tparam  Compare     the type of the function object that orders the values
+ *                      (`std::less<DataType>` by default)
+ * @tparam  Equal       the type of the function object used to match values in
+ *                      searches (`std::equal_to<DataType>` by default)
+ */
+template <typename DataType, typename Compare = std::less<DataType>, typename Equal = std::equal_to<DataType>>
+class SnapshotHeapArray{
+protected:
+    typedef std::shared_ptr<const std::vector<DataType>> partition_ptr;
+
+    struct version{
+        std::vector<partition_ptr> parts;                                                           // the partitions (min-max heaps)
+        std::vector<DataType>      hi;                                                              // the maximum of each one
+        size_t                     count = 0;
+    };
+
+    struct alignas(64) reader_slot{                                                                 // (one per cache line)
+        std::atomic<uint64_t> epoch{0};                                                             // epoch of the open view (0 if none)
+        std::atomic<bool>     claimed{false};                                                       // registered to a reader?
+    };
+
+public:
+    class view;
+    class reader;
+
+    explicit SnapshotHeapArray(size_t max_readers = 64, const Compare& compare = Compare(), const Equal& equality = Equal());
+    SnapshotHeapArray(const SnapshotHeapArray&) = delete;
+    SnapshotHeapArray& operator=(const SnapshotHeapArray&) = delete;
+    ~SnapshotHeapArray();
+
+    reader                  make_reader();
+    void                    insert(const DataType& value);
+    template <typename ForwardIterator>
+    void                    insert_bulk(ForwardIterator first, ForwardIterator last);
+    bool                    remove(const DataType& value);
+    template <typename ForwardIterator>
+    size_t                  remove_bulk(ForwardIterator first, ForwardIterator last);
+    template <typename Predicate>
+    size_t                  erase_if(Predicate pred);
+    size_t                  size()const;
+
+protected:
+    size_t                  _first_partition(const version& v, const DataType& value)const;
+    void                    _rebuild(size_t first_partition, std::vector<DataType>&& suffix);
+    void                    _publish(std::unique_ptr<version> next);
+    void                    _reclaim();
+
+    Compare                                               comp;                                     // orders the values
+    Equal                                                 equal;                                    // matches values in searches
+    std::atomic<version*>                                 current{nullptr};                         // the published version
+    std::atomic<uint64_t>                                 epoch{1};                                 // advanced by each publish
+    std::atomic<size_t>                                   published_count{0};                       // size of the published version
+    std::unique_ptr<reader_slot[]>                        slots;                                    // one per registered reader
+    size_t                                                slot_count;
+    std::mutex                                            writer;                                   // serializes the writers
+    std::vector<std::pair<uint64_t, std::unique_ptr<version>>> retired;                             // replaced versions, and their epochs
+};
+
+/**
+ * @brief   A read-only view of one version of a SnapshotHeapArray.
+ * @details The version stays alive (and unchanged) for as long as the view is open,
+ *          whatever writers do meanwhile; every search runs with no locks and no
+ *          writes to shared memory.  Keep views short-lived: an open view holds back
+ *          the reclamation of every version replaced after it was opened.
+ */
+template <typename DataType, typename Compare, typename Equal>
+class SnapshotHeapArray<DataType, Compare, Equal>::view{
+public:
+    view(view&& rhs) noexcept : owner(rhs.owner), slot(rhs.slot), v(rhs.v){ rhs.slot = nullptr; }
+    view(const view&) = delete;
+    view& operator=(const view&) = delete;
+    view& operator=(view&&) = delete;
+    ~view(){
+        if(slot){
+            slot->epoch.store(0, std::memory_order_release);                                        // (nothing read from `v` after this)
+        }
+    }
+
+    /**
+     * Search the view for a value.
+     * @param  value  the value to search for
+     * @return a pointer to a matching value (valid while the view is open), or nullptr
+     */
+    const DataType* find(const DataType& value)const{
+        auto p = owner->_first_partition(*v, value);
+        if(p == v->parts.size()){
+            return nullptr;
+        }
+        auto& part = *v->parts[p];
+        auto  i    = _heaparray::find_equal(part.data(), part.size(), value, owner->equal);
+        return i < part.size() ? part.data() + i : nullptr;
+    }
+
+    /**
+     * Is `value` present in the view?
+     * @param  value  the value to search for
+     * @return `true` if it is
+     */
+    bool contains(const DataType& value)const{
+        return find(value) != nullptr;
+    }
+
+    /**
+     * Get the number of values in the view.
+     * @return the number of values
+     */
+    size_t size()const{
+        return v->count;
+    }
+
+    /**
+     * Is the view empty?
+     * @return `true` if it holds no values
+     */
+    bool empty()const{
+        return v->count == 0;
+    }
+
+    /**
+     * Get the minimum value in the view.
+     * @return a reference to the minimum value (valid while the view is open)
+     * @throws std::out_of_range if the view is empty
+     */
+    const DataType& min()const{
+        if(v->count == 0){
+            throw std::out_of_range("SnapshotHeapArray is empty.");
+        }
+        return (*v->parts.front())[0];
+    }
+
+    /**
+     * Get the maximum value in the view.
+     * @return a reference to the maximum value (valid while the view is open)
+     * @throws std::out_of_range if the view is empty
+     */
+    const DataType& max()const{
+        if(v->count == 0){
+            throw std::out_of_range("SnapshotHeapArray is empty.");
+        }
+        auto& part = *v->parts.back();
+        return heap_max(part.data(), part.size(), owner->comp);
+    }
+
+private:
+    friend class reader;
+    view(const SnapshotHeapArray* o, reader_slot* s, const version* ver) : owner(o), slot(s), v(ver){}
+
+    const SnapshotHeapArray* owner;
+    reader_slot*             slot;
+    const version*           v;
+};
+
+/**
+ * @brief   A registered reader of a SnapshotHeapArray (one per reading thread).
+ * @details Owns one reader slot, which it gives back when destroyed.  A reader opens
+ *          one view at a time, and must only be used by one thread at a time.
+ */
+template <typename DataType, typename Compare, typename Equal>
+class SnapshotHeapArray<DataType, Compare, Equal>::reader{
+public:
+    reader(reader&& rhs) noexcept : owner(rhs.owner), slot(rhs.slot){ rhs.slot = nullptr; }
+    reader(const reader&) = delete;
+    reader& operator=(const reader&) = delete;
+    reader& operator=(reader&&) = delete;
+    ~reader(){
+        if(slot){
+            slot->claimed.store(false, std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief   Open a view of the current version.
+     * @details Announces the current epoch in this reader's slot, then reads the
+     *          published version; a writer won't free that version until the view
+     *          is closed.
+     *
+     * @return  the view
+     * @throws  std::logic_error if this reader already has a view open
+     */
+    view snapshot()const{
+        if(slot->epoch.load(std::memory_order_relaxed) != 0){
+            throw std::logic_error("This SnapshotHeapArray reader already has a view open.");
+        }
+        slot->epoch.store(owner->epoch.load());                                                     // (sequentially consistent: the announcement
+        return view(owner, slot, owner->current.load());                                            // is visible before the version is read)
+    }
+
+private:
+    friend class SnapshotHeapArray;
+    reader(const SnapshotHeapArray* o, reader_slot* s) : owner(o), slot(s){}
+
+    const SnapshotHeapArray* owner;
+    reader_slot*             slot;
+};
+
+/**
+ * Construct an empty SnapshotHeapArray.
+ *
+ * @param max_readers  the number of readers that may be registered at once
+ * @param compare      the comparison function object (default-constructed if not given)
+ * @param equality     the equality function object (default-constructed if not given)
+ */
+template <typename DataType, typename Compare, typename Equal>
+SnapshotHeapArray<DataType, Compare, Equal>::SnapshotHeapArray(size_t max_readers, const Compare& compare, const Equal& equality)
+    : comp(compare), equal(equality), slots(new reader_slot[max_readers]), slot_count(max_readers){
+    current.store(new version);
+}
+
+/**
+ * Destroy the SnapshotHeapArray, freeing every version; no reader may have a view
+ * open, or still be registered.
+ */
+template <typename DataType, typename Compare, typename Equal>
+SnapshotHeapArray<DataType, Compare, Equal>::~SnapshotHeapArray(){
+    delete current.load();
+}
+
+/**
+ * Register a reader (one per reading thread).
+ * @return the reader, which holds its slot until it is destroyed
+ * @throws std::length_error if `max_readers` readers are already registered
+ */
+template <typename DataType, typename Compare, typename Equal>
+typename SnapshotHeapArray<DataType, Compare, Equal>::reader SnapshotHeapArray<DataType, Compare, Equal>::make_reader(){
+    for(size_t i = 0; i < slot_count; ++i){
+        bool free = false;
+        if(slots[i].claimed.compare_exchange_strong(free, true)){
+            return reader(this, &slots[i]);
+        }
+    }
+    throw std::length_error("Too many SnapshotHeapArray readers.");
+}
+
+/**
+ * Insert a new item (see `insert_bulk`).
+ * @param value  the value to insert
+ */
+template <typename DataType, typename Compare, typename Equal>
+void SnapshotHeapArray<DataType, Compare, Equal>::insert(const DataType& value){
+    insert_bulk(&value, &value + 1);
+}
+
+/**
+ * @brief   Insert a batch of new items, publishing a new version.
+ * @details Every partition before the one the smallest new value belongs in is
+ *          shared with the current version; the rest are rebuilt with the batch (by
+ *          selection, as in `HeapArray::insert_bulk`).  Readers keep seeing the old
+ *          version until the new one is published.
+ *
+ * @param  first  iterator to the first value to insert
+ * @param  last   iterator to the position following the last value to insert
+ * @tparam ForwardIterator  an iterator type satisfying ForwardIterator, whose value
+ *                          type is assignable to `DataType`
+ */
+template <typename DataType, typename Compare, typename Equal>
+template <typename ForwardIterator>
+void SnapshotHeapArray<DataType, Compare, Equal>::insert_bulk(ForwardIterator first, ForwardIterator last){
+    if(first == last){
+        return;
+    }
+    std::lock_guard<std::mutex> lock(writer);
+    auto& old = *current.load();
+    std::vector<DataType> batch(first, last);
+    auto p = old.parts.empty() ? 0 : std::min(_first_partition(old, *std::min_element(batch.begin(), batch.end(), comp)),
+                                              old.parts.size() - 1);                                // (past every maximum: the final one)
+    std::vector<DataType> suffix;
+    suffix.reserve(old.count - p * p + batch.size());
+    for(auto q = p; q < old.parts.size(); ++q){
+        suffix.insert(suffix.end(), old.parts[q]->begin(), old.parts[q]->end());
+    }
+    std::move(batch.begin(), batch.end(), std::back_inserter(suffix));
+    _rebuild(p, std::move(suffix));
+}
+
+/**
+ * Remove one instance of a value (see `remove_bulk`).
+ * @param  value  the value to remove
+ * @return `true` if `value` was found and removed
+ */
+template <typename DataType, typename Compare, typename Equal>
+bool SnapshotHeapArray<DataType, Compare, Equal>::remove(const DataType& value){
+    return remove_bulk(&value, &value + 1) == 1;
+}
+
+/**
+ * @brief   Remove a batch of elements, publishing a new version.
+ * @details Removes one instance of each value in the range [first, last) (values that
+ *          are not present are ignored).  Partitions before the first one that could
+ *          hold any of the values are shared with the current version; the rest are
+ *          rebuilt without the victims.  Nothing is published if nothing was removed.
+ *
+ * @param  first  iterator to the first value to remove
+ * @param  last   iterator to the position following the last value to remove
+ * @tparam ForwardIterator  an iterator type satisfying ForwardIterator, whose value
+ *                          type is `DataType`
+ * @return the number of elements removed
+ */
+template <typename DataType, typename Compare, typename Equal>
+template <typename ForwardIterator>
+size_t SnapshotHeapArray<DataType, Compare, Equal>::remove_bulk(ForwardIterator first, ForwardIterator last){
+    std::vector<DataType> victims(first, last);
+    std::lock_guard<std::mutex> lock(writer);
+    auto& old = *current.load();
+    if(victims.empty() || old.count == 0){
+        return 0;
+    }
+    std::sort(victims.begin(), victims.end(), comp);
+    std::vector<bool> used(victims.size(), false);                                                 // (each victim removes one instance)
+    auto p = _first_partition(old, victims.front());
+    std::vector<DataType> suffix;
+    size_t removed = 0;
+    for(auto q = p; q < old.parts.size(); ++q){
+        for(auto& value : *old.parts[q]){
+            auto v = std::lower_bound(victims.begin(), victims.end(), value, comp);
+            while(v != victims.end() && equal(*v, value) && used[v - victims.begin()]){
+                ++v;
+            }
+            if(v != victims.end() && equal(*v, value)){
+                used[v - victims.begin()] = true;
+                ++removed;
+            }
+            else{
+                suffix.push_back(value);
+            }
+        }
+    }
+    if(removed > 0){
+        _rebuild(p, std::move(suffix));
+    }
+    return removed;
+}
+
+/**
+ * @brief   Remove every element for which a predicate holds, publishing a new version.
+ * @details Partitions before the first one holding a victim are shared with the
+ *          current version; the rest are rebuilt without the victims.  `pred` is called
+ *          once per value.  Nothing is published if nothing was removed.
+ *
+ * @param  pred  unary predicate taking a `const DataType&`; returns `true` for values to remove
+ * @tparam Predicate  a callable type satisfying the UnaryPredicate requirements
+ * @return the number of elements removed
+ */
+template <typename DataType, typename Compare, typename Equal>
+template <typename Predicate>
+size_t SnapshotHeapArray<DataType, Compare, Equal>::erase_if(Predicate pred){
+    std::lock_guard<std::mutex> lock(writer);
+    auto& old = *current.load();
+    auto  p   = old.parts.size();                                                                   // (the first partition with a victim)
+    std::vector<DataType> suffix;
+    size_t removed = 0;
+    for(size_t q = 0; q < old.parts.size(); ++q){
+        auto& part = *old.parts[q];
+        for(size_t i = 0; i < part.size(); ++i){
+            if(pred(part[i])){
+                if(p == old.parts.size()){
+                    p = q;
+                    suffix.assign(part.begin(), part.begin() + i);                                  // (the survivors before this victim)
+                }
+                ++removed;
+            }
+            else if(p < old.parts.size()){
+                suffix.push_back(part[i]);
+            }
+        }
+    }
+    if(removed > 0){
+        _rebuild(p, std::move(suffix));
+    }
+    return removed;
+}
+
+/**
+ * Get the number of values in the most recently published version.
+ * @return the number of values
+ */
+template <typename DataType, typename Compare, typename Equal>
+inline size_t SnapshotHeapArray<DataType, Compare, Equal>::size()const{
+    return published_count.load(std::memory_order_relaxed);
+}
+
+/*
+ * Finds the first partition of version `v` whose maximum is not less than `value`
+ * (`v.parts.size()` if there is none), by binary search over the index of maxima.
+ */
+template <typename DataType, typename Compare, typename Equal>
+size_t SnapshotHeapArray<DataType, Compare, Equal>::_first_partition(const version& v, const DataType& value)const{
+    return std::lower_bound(v.hi.begin(), v.hi.end(), value, comp) - v.hi.begin();
+}
+
+/*
+ * Builds and publishes the next version: partitions [0, first_partition) are shared
+ * with the current version, and the values in `suffix` (which must all belong after
+ * them) are split into new partitions from `first_partition` on.
+ */
+template <typename DataType, typename Compare, typename Equal>
+void SnapshotHeapArray<DataType, Compare, Equal>::_rebuild(size_t first_partition, std::vector<DataType>&& suffix){
+    auto& old   = *current.load();
+    auto  next  = std::unique_ptr<version>(new version);
+    auto  first = first_partition * first_partition;
+    next->count = first + suffix.size();
+    next->parts.assign(old.parts.begin(), old.parts.begin() + first_partition);
+    next->hi.assign(old.hi.begin(), old.hi.begin() + first_partition);
+    auto parts  = next->count > 0 ? _heaparray::isqrt(next->count - 1) + 1 : 0;
+    _heaparray::select_partitions<square_geometry>(suffix.begin(), first, next->count, first_partition, parts, comp);
+    for(auto p = first_partition; p < parts; ++p){
+        auto begin = suffix.begin() + (p * p - first);
+        auto end   = suffix.begin() + (std::min(next->count, (p + 1) * (p + 1)) - first);
+        auto part  = std::make_shared<std::vector<DataType>>(std::make_move_iterator(begin), std::make_move_iterator(end));
+        mmheap::make_heap(part->data(), part->size(), comp);
+        next->hi.push_back(heap_max(part->data(), part->size(), comp));
+        next->parts.push_back(std::move(part));
+    }
+    _publish(std::move(next));
+}
+
+/*
+ * Publishes `next` as the current version and retires the old one, tagged with the
+ * epoch in which it was replaced, then frees whatever retired versions no open view
+ * can still be using.
+ */
+template <typename DataType, typename Compare, typename Equal>
+void SnapshotHeapArray<DataType, Compare, Equal>::_publish(std::unique_ptr<version> next){
+    published_count.store(next->count, std::memory_order_relaxed);
+    std::unique_ptr<version> old(current.exchange(next.release()));
+    retired.emplace_back(epoch.fetch_add(1), std::move(old));                                       // views opened from here on see `next`
+    _reclaim();
+}
+
+/*
+ * Frees every retired version that was replaced before the oldest open view was
+ * opened (a view that announced epoch `e` can only be using versions retired in
+ * epoch `e` or later).
+ */
+template <typename DataType, typename Compare, typename Equal>
+void SnapshotHeapArray<DataType, Compare, Equal>::_reclaim(){
+    auto oldest = epoch.load();
+    for(size_t i = 0; i < slot_count; ++i){
+        auto e = slots[i].epoch.load();
+        if(e != 0){
+            oldest = std::min(oldest, e);
+        }
+    }
+    retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                 [oldest](const std::pair<uint64_t, std::unique_ptr<version>>& r){ return r.first < oldest; }),
+                  retired.end());
+}
+
+#endif
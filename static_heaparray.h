@@ -0,0 +1,333 @@
+#ifndef STATIC_HEAPARRAY_H
+#define STATIC_HEAPARRAY_H
+/**
+ * @file static_heaparray.h
+ *
+ * Defines the StaticHeapArray, a HeapArray of fixed capacity whose storage lives
+ * inside the object itself.  It never allocates, does no square-root arithmetic
+ * (partition lookups use tables computed at compile time), and reports a full
+ * container through its return value rather than with an exception, for the
+ * many small containers (tens to hundreds of values) where those costs dominate.
+ *
+ *
+ * @author    Jason L Causey
+ * @license   Released under the MIT License: http://opensource.org/licenses/MIT
+ * @copyright Copyright (c) 2015 Jason L Causey, Arkansas State University
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include "mmheap.h"
+#include "partition_scan.h"
+
+namespace _heaparray{
+    /**
+     * Builds, at compile time, the partition-index of each of the first `Capacity`
+     * slots of a HeapArray (partition `p` holds slots `p*p` to `p*p + 2p`).
+     *
+     * @tparam IndexType  the (unsigned integer) type of the table entries
+     * @tparam Capacity   the number of slots
+     * @return the table
+     */
+    template <typename IndexType, size_t Capacity>
+    constexpr std::array<IndexType, Capacity> partition_table(){
+        std::array<IndexType, Capacity> table{};
+        size_t p = 0;
+        for(size_t i = 0; i < Capacity; ++i){
+            p        += i == (p + 1) * (p + 1) ? 1 : 0;
+            table[i]  = static_cast<IndexType>(p);
+        }
+        return table;
+    }
+}
+
+/**
+ * @brief   A HeapArray of at most `Capacity` values, stored inline.
+ * @details The values are kept as in a HeapArray (partition `p` holds slots `p*p` to
+ *          `p*p + 2p`, each partition a min-max heap, the partitions in order), in a
+ *          `std::array` member, so a StaticHeapArray is created, copied and destroyed
+ *          without touching the heap.  The partition holding each slot is looked up in
+ *          a table built at compile time, one byte per slot for capacities up to 65536
+ *          and two above that.  Building the table takes one constexpr loop step per
+ *          slot, so `Capacity` is limited to 262144 (GCC's default loop limit).
+ *          The partitions are small and the bounds of each are read from its heap in
+ *          O(1), so there is no bounds cache.
+ *
+ *          `insert` returns `false`, rather than throwing, if the container is full;
+ *          `min()` and `max()` must not be called on an empty container.  Nothing else
+ *          in this class throws (the comparison and equality objects, and `DataType`'s
+ *          copy and move operations, still may).
+ *
+ * @tparam  DataType    the type of data stored - same requirements as the `DataType`
+ *                      of a HeapArray, and DefaultConstructible (the unused slots
+ *                      hold default-constructed values)
+ * @tparam  Capacity    the maximum number of values
+ * @tparam  Compare     the type of the function object that orders the values
+ *                      (`std::less<DataType>` by default)
+ * @tparam  Equal       the type of the function object used to match values in
+ *                      searches (`std::equal_to<DataType>` by default)
+ */
+template <typename DataType, size_t Capacity, typename Compare = std::less<DataType>, typename Equal = std::equal_to<DataType>>
+class StaticHeapArray{
+    static_assert(Capacity > 0, "A StaticHeapArray must have room for at least one value.");
+    static_assert(Capacity <= (size_t{1} << 18), "StaticHeapArray holds at most 262144 values (its partition table is built at compile time); use HeapArray.");
+
+public:
+    typedef const DataType* const_iterator;
+
+    StaticHeapArray() = default;
+    StaticHeapArray(const Compare& compare, const Equal& equality);
+
+    bool                    insert(const DataType& value);
+    bool                    insert(DataType&& value);
+    bool                    remove(const DataType& value);
+    std::pair<bool, size_t> find(const DataType& value)const;
+    bool                    contains(const DataType& value)const;
+    const DataType&         min()const;
+    const DataType&         max()const;
+    void                    clear();
+    size_t                  size()const                             { return count;              }
+    bool                    empty()const                            { return count == 0;         }
+    bool                    full()const                             { return count == Capacity;  }
+    static constexpr size_t capacity()                              { return Capacity;           }
+    const DataType&         operator[](size_t index)const           { return data[index];        }
+    const_iterator          begin()const                            { return data.data();        }
+    const_iterator          end()const                              { return data.data() + count; }
+
+protected:
+    typedef typename std::conditional<(Capacity <= 65536), uint8_t, uint16_t>::type partition_type;
+
+    static constexpr std::array<partition_type, Capacity> partition_of                            // partition-index of every slot
+                            = _heaparray::partition_table<partition_type, Capacity>();
+
+    static constexpr size_t _partition_start(size_t p)                 { return p * p;     }
+    static constexpr size_t _partition_size(size_t p)                  { return 2 * p + 1; }
+    size_t                  _final_partition()const;
+    size_t                  _count_in_partition(size_t p)const;
+    size_t                  _find_partition(const DataType& value)const;
+    std::pair<bool, size_t> _find(const DataType& value, size_t& partition)const;
+
+    std::array<DataType, Capacity> data{};                                                          // the values, in partition order
+    size_t                         count = 0;                                                       // the number of them
+    Compare                        comp;                                                            // orders the values
+    Equal                          equal;                                                           // matches values in searches
+};
+
+/**
+ * Construct an empty StaticHeapArray with the given comparison and equality objects.
+ *
+ * @param compare   the function object that orders the values
+ * @param equality  the function object used to match values in searches
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+StaticHeapArray<DataType, Capacity, Compare, Equal>::StaticHeapArray(const Compare& compare, const Equal& equality)
+    : comp(compare), equal(equality){}
+
+/**
+ * Insert a copy of a value.
+ *
+ * @param  value  the value to insert
+ * @return `false` (and the container is unchanged) if the container is full
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+bool StaticHeapArray<DataType, Capacity, Compare, Equal>::insert(const DataType& value){
+    return insert(DataType(value));
+}
+
+/**
+ * @brief   Insert a value, moving it into place.
+ * @details As in a HeapArray:  the value goes into the first partition whose maximum is
+ *          not less than it, and each full partition passes its maximum on to the next
+ *          ("ripples") until the final partition takes the last one.
+ *
+ * @param  value  the value to insert
+ * @return `false` (and the container is unchanged) if the container is full
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+bool StaticHeapArray<DataType, Capacity, Compare, Equal>::insert(DataType&& value){
+    if(count == Capacity){
+        return false;
+    }
+    auto partition = _find_partition(value);
+    auto ripple    = std::pair<bool, DataType>{true, std::move(value)};
+    ++count;                                                                                        // (so the final partition has room)
+    while(ripple.first){
+        auto p_count = _count_in_partition(partition) - (partition == _final_partition() ? 1 : 0);
+        ripple       = mmheap::heap_insert_circular(std::move(ripple.second), data.data() + _partition_start(partition),
+                                                    p_count, _partition_size(partition), comp);
+        ++partition;
+    }
+    return true;
+}
+
+/**
+ * @brief   Remove one instance of a value, if there is one.
+ * @details As in a HeapArray:  the victim is replaced by a value rippled back from the
+ *          final partition, one partition minimum at a time.
+ *
+ * @param  value  the value to remove
+ * @return `true` if a value was removed
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+bool StaticHeapArray<DataType, Capacity, Compare, Equal>::remove(const DataType& value){
+    size_t partition = 0;
+    auto   found     = _find(value, partition);
+    if(!found.first){
+        return false;
+    }
+    auto   final   = _final_partition();
+    auto   offset  = found.second - _partition_start(partition);
+    size_t p_count = _count_in_partition(final);
+    if(partition == final){
+        mmheap::heap_remove_at_index(offset, data.data() + _partition_start(final), p_count, comp);
+    }
+    else{
+        auto ripple = mmheap::heap_remove_min(data.data() + _partition_start(final), p_count, comp);
+        for(auto p = final - 1; p > partition; --p){
+            ripple = mmheap::heap_replace_at_index(std::move(ripple), 0, data.data() + _partition_start(p),
+                                                   _partition_size(p), comp);
+        }
+        mmheap::heap_replace_at_index(std::move(ripple), offset, data.data() + _partition_start(partition),
+                                      _partition_size(partition), comp);
+    }
+    data[--count] = DataType();                                                                     // (release what the vacated slot held)
+    return true;
+}
+
+/**
+ * Find the location of a value.
+ *
+ * @param  value  the value to search for
+ * @return a pair: whether the value was found, and if so, its index (for `operator[]`)
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+std::pair<bool, size_t> StaticHeapArray<DataType, Capacity, Compare, Equal>::find(const DataType& value)const{
+    size_t partition = 0;
+    return _find(value, partition);
+}
+
+/**
+ * Determine whether a value is present.
+ *
+ * @param  value  the value to search for
+ * @return `true` if it is
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+bool StaticHeapArray<DataType, Capacity, Compare, Equal>::contains(const DataType& value)const{
+    return find(value).first;
+}
+
+/**
+ * Get the minimum value; the container must not be empty.
+ * @return a reference to the minimum value (valid until the container is next modified)
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+const DataType& StaticHeapArray<DataType, Capacity, Compare, Equal>::min()const{
+    return data[0];
+}
+
+/**
+ * Get the maximum value; the container must not be empty.
+ * @return a reference to the maximum value (valid until the container is next modified)
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+const DataType& StaticHeapArray<DataType, Capacity, Compare, Equal>::max()const{
+    auto final = _final_partition();
+    return mmheap::heap_max(data.data() + _partition_start(final), _count_in_partition(final), comp);
+}
+
+/**
+ * Remove every value.
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+void StaticHeapArray<DataType, Capacity, Compare, Equal>::clear(){
+    for(size_t i = 0; i < count; ++i){
+        data[i] = DataType();
+    }
+    count = 0;
+}
+
+/*
+ * partition-index of the final (possibly partially full) partition; 0 if empty
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+size_t StaticHeapArray<DataType, Capacity, Compare, Equal>::_final_partition()const{
+    return count > 0 ? partition_of[count - 1] : 0;
+}
+
+/*
+ * number of values in partition `p` (only the final partition may be partially full)
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+size_t StaticHeapArray<DataType, Capacity, Compare, Equal>::_count_in_partition(size_t p)const{
+    return p == _final_partition() ? count - _partition_start(p) : _partition_size(p);
+}
+
+/*
+ * finds the partition `value` belongs in: the first whose maximum is not less than
+ * `value`, or the final partition if there is none
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+size_t StaticHeapArray<DataType, Capacity, Compare, Equal>::_find_partition(const DataType& value)const{
+    size_t left  = 0;
+    size_t right = _final_partition();
+    while(left < right){                                                                            // binary search on the partition maxima
+        auto mid = left + (right - left) / 2;
+        if(comp(mmheap::heap_max(data.data() + _partition_start(mid), _partition_size(mid), comp), value)){
+            left = mid + 1;
+        }
+        else{
+            right = mid;
+        }
+    }
+    return left;
+}
+
+/*
+ * searches for `value`, starting in the partition it belongs in and continuing into
+ * later partitions while their minimum is not greater than `value` (duplicates can
+ * straddle partitions); sets `partition` to where it was found
+ */
+template <typename DataType, size_t Capacity, typename Compare, typename Equal>
+std::pair<bool, size_t> StaticHeapArray<DataType, Capacity, Compare, Equal>::_find(const DataType& value, size_t& partition)const{
+    if(count == 0){
+        return {false, 0};
+    }
+    auto first = _find_partition(value);
+    auto final = _final_partition();
+    for(partition = first; partition <= final; ++partition){
+        auto start = _partition_start(partition);
+        if(partition > first && comp(value, data[start])){
+            break;                                                                                  // (every later value is greater)
+        }
+        auto n = _count_in_partition(partition);
+        auto i = _heaparray::find_equal(data.data() + start, n, value, equal);
+        if(i < n){
+            return {true, start + i};
+        }
+    }
+    return {false, 0};
+}
+
+#endif
@@ -0,0 +1,353 @@
+/**
+ * Benchmarks HeapArray, with std::multiset for reference, using Google Benchmark:
+ * construction, insert, remove, find (hits and misses) and a mixed workload, each
+ * on `int`, `std::string` and 64-byte struct values.
+ *
+ * Sizes run from 1e3 to 1e6 values by default; pass `--max_size=N` (up to 1e8) for
+ * larger ones.  Sizes past 1e7 are run only for HeapArray<int>, since the other
+ * containers and payloads would need tens of GB there.  All data comes from
+ * fixed seeds, so every run measures the same values.  Each HeapArray benchmark also
+ * reports the work behind its timings (partitions rippled, values scanned and
+ * binary-search steps per operation), counted on a `counting_stats` twin outside
+ * the timed loop.
+ *
+ * Write machine-readable results with `--benchmark_out=<file>
+ * --benchmark_out_format=json` (the `run_benchmarks` build target does this), and
+ * read hardware counters with `--benchmark_perf_counters=CYCLES,INSTRUCTIONS` if
+ * the library was built with libpfm.
+ */
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "../heaparray.h"
+
+namespace{
+
+/*
+ * a 64-byte value: the key, and a payload that only rides along
+ */
+struct large_value{
+    int64_t key;
+    char    payload[56];
+
+    bool operator<(const large_value& rhs)const{ return key < rhs.key; }
+    bool operator==(const large_value& rhs)const{ return key == rhs.key; }
+};
+
+/*
+ * the value for `key` (fixed-width decimal strings, so string order is key order,
+ * and too long for the small-string buffer)
+ */
+template <typename T>
+T make_value(uint64_t key);
+
+template <>
+int make_value<int>(uint64_t key){
+    return static_cast<int>(key);
+}
+
+template <>
+std::string make_value<std::string>(uint64_t key){
+    auto digits = std::to_string(key);
+    return std::string(24 - digits.size(), '0') + digits;
+}
+
+template <>
+large_value make_value<large_value>(uint64_t key){
+    large_value value;
+    value.key = static_cast<int64_t>(key);
+    std::memset(value.payload, static_cast<int>(key & 0xff), sizeof(value.payload));
+    return value;
+}
+
+const size_t  QUERIES           = 4096;                                         // distinct keys each timed loop cycles through
+const size_t  MIXED_LAG         = 64;                                           // inserts a mixed workload keeps in flight
+const size_t  SAMPLE_OPERATIONS = 256;                                          // operations counted for the work counters
+const size_t  REFERENCE_LIMIT   = 10000000;                                     // largest size for all but HeapArray<int>
+
+/*
+ * the keys of a data set of `n` values, and of keys to query and insert:  the data
+ * set's keys are even, from [0, 8n), and the ones queried for misses are odd, so
+ * they never match
+ */
+struct key_set{
+    std::vector<uint64_t> stored;                                               // the data set
+    std::vector<uint64_t> hits;                                                 // QUERIES keys from it
+    std::vector<uint64_t> misses;                                               // QUERIES keys not in it
+    std::vector<uint64_t> fresh;                                                // QUERIES new (even) keys, to insert
+};
+
+const key_set& keys_for(size_t n){
+    static std::map<size_t, key_set> cache;
+    auto found = cache.find(n);
+    if(found != cache.end()){
+        return found->second;
+    }
+    std::mt19937_64 rng(0x5eed + n);
+    std::uniform_int_distribution<uint64_t> key(0, 4 * n - 1);
+    key_set keys;
+    keys.stored.resize(n);
+    for(auto& k : keys.stored){
+        k = key(rng) * 2;
+    }
+    std::uniform_int_distribution<size_t> index(0, n - 1);
+    for(size_t i = 0; i < QUERIES; ++i){
+        keys.hits.push_back(keys.stored[index(rng)]);
+        keys.misses.push_back(key(rng) * 2 + 1);
+        keys.fresh.push_back(key(rng) * 2);
+    }
+    return cache.emplace(n, std::move(keys)).first->second;
+}
+
+template <typename T>
+std::vector<T> values_of(const std::vector<uint64_t>& keys){
+    std::vector<T> values;
+    values.reserve(keys.size());
+    for(auto k : keys){
+        values.push_back(make_value<T>(k));
+    }
+    return values;
+}
+
+template <typename T, typename Stats = no_stats>
+using heaparray_of = HeapArray<T, std::less<T>, std::equal_to<T>, std::allocator<T>, contiguous_storage, square_geometry, Stats>;
+
+/*
+ * the adapters that let one benchmark body drive either container
+ */
+template <typename T, typename Stats>
+heaparray_of<T, Stats> build(heaparray_of<T, Stats>*, std::vector<T>& values){
+    return heaparray_of<T, Stats>(values.data(), values.data() + values.size());
+}
+
+template <typename T>
+std::multiset<T> build(std::multiset<T>*, std::vector<T>& values){
+    return std::multiset<T>(values.begin(), values.end());
+}
+
+template <typename T, typename Stats>
+bool contains(const heaparray_of<T, Stats>& container, const T& value){
+    return container.contains(value);
+}
+
+template <typename T>
+bool contains(const std::multiset<T>& container, const T& value){
+    return container.find(value) != container.end();
+}
+
+template <typename T, typename Stats>
+bool remove(heaparray_of<T, Stats>& container, const T& value){
+    return container.remove(value);
+}
+
+template <typename T>
+bool remove(std::multiset<T>& container, const T& value){
+    auto found = container.find(value);
+    if(found == container.end()){
+        return false;
+    }
+    container.erase(found);
+    return true;
+}
+
+/*
+ * runs `operation(container, i)` for i = 0, 1, ... on a counting twin of the data
+ * set, and reports the mean work per operation as counters (HeapArray only)
+ */
+template <typename T, typename Operation>
+void report_work(benchmark::State& state, heaparray_of<T>*, std::vector<T>& values, Operation operation){
+    auto twin = build(static_cast<heaparray_of<T, counting_stats>*>(nullptr), values);
+    for(size_t i = 0; i < SAMPLE_OPERATIONS; ++i){
+        operation(twin, i);
+    }
+    auto& stats = twin.statistics();
+    if(stats.ripples.samples > 0){
+        state.counters["ripple_partitions"] = stats.ripples.mean();
+    }
+    if(stats.scans.samples > 0){
+        state.counters["scanned_values"] = stats.scans.mean();
+    }
+    if(stats.searches.samples > 0){
+        state.counters["search_steps"] = stats.searches.mean();
+    }
+}
+
+template <typename T, typename Operation>
+void report_work(benchmark::State&, std::multiset<T>*, std::vector<T>&, Operation){
+}
+
+/*
+ * the benchmarks; each takes the size of the data set as its argument
+ */
+template <typename Container, typename T>
+void bm_build(benchmark::State& state){
+    auto values = values_of<T>(keys_for(state.range(0)).stored);
+    for(auto _ : state){
+        auto container = build(static_cast<Container*>(nullptr), values);
+        benchmark::DoNotOptimize(container);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+template <typename Container, typename T, bool Hit>
+void bm_find(benchmark::State& state){
+    auto& keys      = keys_for(state.range(0));
+    auto  values    = values_of<T>(keys.stored);
+    auto  queries   = values_of<T>(Hit ? keys.hits : keys.misses);
+    auto  container = build(static_cast<Container*>(nullptr), values);
+    size_t i = 0;
+    for(auto _ : state){
+        benchmark::DoNotOptimize(contains(container, queries[i++ % QUERIES]));
+    }
+    state.SetItemsProcessed(state.iterations());
+    report_work(state, &container, values, [&queries](auto& twin, size_t j){ contains(twin, queries[j % QUERIES]); });
+}
+
+/*
+ * inserts (or removes) a run of values at a time, then takes them back out (or puts
+ * them back) with the timer paused, so the size barely drifts
+ */
+template <typename Container, typename T>
+void bm_insert(benchmark::State& state){
+    auto&  keys      = keys_for(state.range(0));
+    auto   values    = values_of<T>(keys.stored);
+    auto   fresh     = values_of<T>(keys.fresh);
+    auto   container = build(static_cast<Container*>(nullptr), values);
+    auto   run       = std::max<size_t>(64, std::min<size_t>(QUERIES, values.size() / 8));
+    size_t i = 0;
+    for(auto _ : state){
+        container.insert(fresh[i++ % run]);
+        if(i % run == 0){
+            state.PauseTiming();
+            for(size_t j = 0; j < run; ++j){
+                remove(container, fresh[j]);
+            }
+            state.ResumeTiming();
+        }
+    }
+    benchmark::DoNotOptimize(container);
+    state.SetItemsProcessed(state.iterations());
+    report_work(state, &container, values, [&fresh](auto& twin, size_t j){ twin.insert(fresh[j % QUERIES]); });
+}
+
+template <typename Container, typename T>
+void bm_remove(benchmark::State& state){
+    auto&  keys      = keys_for(state.range(0));
+    auto   values    = values_of<T>(keys.stored);
+    auto   victims   = values_of<T>(keys.stored);
+    std::shuffle(victims.begin(), victims.end(), std::mt19937_64(0x5eed));
+    auto   container = build(static_cast<Container*>(nullptr), values);
+    auto   run       = std::max<size_t>(1, std::min<size_t>(QUERIES, values.size() / 8));
+    size_t i = 0;
+    for(auto _ : state){
+        benchmark::DoNotOptimize(remove(container, victims[i++ % run]));
+        if(i % run == 0){
+            state.PauseTiming();
+            for(size_t j = 0; j < run; ++j){
+                container.insert(victims[j]);
+            }
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    report_work(state, &container, values, [&victims](auto& twin, size_t j){ remove(twin, victims[j]); });
+}
+
+/*
+ * each iteration is two finds (a hit and a miss), an insert, and the removal of the
+ * value inserted MIXED_LAG iterations before, so the size stays steady
+ */
+template <typename Container, typename T>
+void bm_mixed(benchmark::State& state){
+    auto& keys      = keys_for(state.range(0));
+    auto  values    = values_of<T>(keys.stored);
+    auto  hits      = values_of<T>(keys.hits);
+    auto  misses    = values_of<T>(keys.misses);
+    auto  fresh     = values_of<T>(keys.fresh);
+    auto  container = build(static_cast<Container*>(nullptr), values);
+    auto  step      = [&hits, &misses, &fresh](auto& c, size_t i){
+        benchmark::DoNotOptimize(contains(c, hits[i % QUERIES]));
+        benchmark::DoNotOptimize(contains(c, misses[i % QUERIES]));
+        c.insert(fresh[i % QUERIES]);
+        if(i >= MIXED_LAG){
+            remove(c, fresh[(i - MIXED_LAG) % QUERIES]);
+        }
+    };
+    size_t i = 0;
+    for(auto _ : state){
+        step(container, i++);
+    }
+    state.SetItemsProcessed(state.iterations() * 4);
+    report_work(state, &container, values, step);
+}
+
+/*
+ * registers every benchmark for values of type `T` (named, for example,
+ * "find_hit/HeapArray<int>/1000000"), at each size up to `max_size`
+ */
+template <typename T>
+void register_type(const std::string& type, size_t max_size, bool large_sizes){
+    typedef heaparray_of<T>   heaparray;
+    typedef std::multiset<T>  multiset;
+    struct suite{
+        const char* name;
+        void      (*heaparray_run)(benchmark::State&);
+        void      (*multiset_run)(benchmark::State&);
+    };
+    const suite suites[] = {
+        {"build",     bm_build<heaparray, T>,        bm_build<multiset, T>},
+        {"insert",    bm_insert<heaparray, T>,       bm_insert<multiset, T>},
+        {"remove",    bm_remove<heaparray, T>,       bm_remove<multiset, T>},
+        {"find_hit",  bm_find<heaparray, T, true>,   bm_find<multiset, T, true>},
+        {"find_miss", bm_find<heaparray, T, false>,  bm_find<multiset, T, false>},
+        {"mixed",     bm_mixed<heaparray, T>,        bm_mixed<multiset, T>},
+    };
+    for(auto& s : suites){
+        auto h = benchmark::RegisterBenchmark((std::string(s.name) + "/HeapArray<" + type + ">").c_str(), s.heaparray_run);
+        auto m = benchmark::RegisterBenchmark((std::string(s.name) + "/multiset<" + type + ">").c_str(), s.multiset_run);
+        for(size_t n = 1000; n <= max_size; n *= 10){
+            if(large_sizes || n <= REFERENCE_LIMIT){
+                h->Arg(n);
+            }
+            if(n <= REFERENCE_LIMIT){
+                m->Arg(n);
+            }
+        }
+        auto unit = std::string(s.name) == "build" ? benchmark::kMillisecond : benchmark::kNanosecond;
+        h->Unit(unit);
+        m->Unit(unit);
+    }
+}
+
+}
+
+int main(int argc, char** argv){
+    size_t max_size = 1000000;
+    for(int i = 1; i < argc; ++i){                                                  // take out `--max_size=N` before the
+        if(std::strncmp(argv[i], "--max_size=", 11) == 0){                          // library sees the arguments
+            max_size = std::min<size_t>(std::strtoull(argv[i] + 11, nullptr, 10), 100000000);
+            std::copy(argv + i + 1, argv + argc, argv + i);
+            --argc;
+            --i;
+        }
+    }
+    register_type<int>("int", max_size, true);
+    register_type<std::string>("string", max_size, false);
+    register_type<large_value>("large_value", max_size, false);
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv)){
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
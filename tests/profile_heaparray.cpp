@@ -14,6 +14,25 @@
     using std::setw;
 #include "../heaparray.h"
 
+/*
+ * times a mixed workload (one search, insert and remove per key) on a HeapArray of
+ * `data` laid out with `scaled_geometry<Scale>`
+ */
+template <size_t Scale>
+double time_geometry(std::vector<int> data, const std::vector<int>& keys) {
+    HeapArray<int, std::less<int>, std::equal_to<int>, std::allocator<int>, contiguous_storage, scaled_geometry<Scale>> h{data.data(), data.data() + data.size()};
+    size_t found = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for(auto k : keys){
+        found += h.contains(k) ? 1 : 0;
+        h.insert(k);
+        h.remove(k);
+    }
+    auto end   = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end-begin;
+    return duration.count() + (found > keys.size() ? 1 : 0);                // (keeps `found` live)
+}
+
 int main() {
     std::chrono::high_resolution_clock::time_point   begin, end;
     std::chrono::duration<double> ha_duration, sv_duration, ms_duration;
@@ -255,5 +274,82 @@ int main() {
         std::cout << std::flush;
     }
 
+    std::cout << "\nBatched search timing (find VS find_many, 2 * TSIZE lookups, half of them absent):\n";
+    std::cout << setw(15) << "Data-Size" << ", " << setw(15) << "#-Searches" << ", " << setw(15) << "find" << ", " << setw(15) << "find_many\n";
+    for(size_t incremental = 1 << 16; incremental <= (1 << 24); incremental *= 4){
+        std::vector<int> data(incremental);
+        for(auto& d : data){
+            d = rand() % (2 * incremental);
+        }
+        HeapArray<int>   h{data.data(), data.data() + incremental};
+        std::vector<int> keys(2 * TSIZE);
+        for(auto& k : keys){
+            k = rand() % 2 ? data[rand() % incremental] : rand() % (2 * incremental);
+        }
+        std::vector<std::pair<bool, size_t>> results(keys.size());
+
+        begin = std::chrono::high_resolution_clock::now();
+        for(size_t i = 0; i < keys.size(); ++i){
+            results[i] = h.find(keys[i]);
+        }
+        end   = std::chrono::high_resolution_clock::now();
+        sv_duration = end-begin;
+        sv_seconds  = sv_duration.count();
+
+        begin = std::chrono::high_resolution_clock::now();
+        h.find_many(keys.data(), keys.size(), results.data());
+        end   = std::chrono::high_resolution_clock::now();
+        ha_duration = end-begin;
+        ha_seconds  = ha_duration.count();
+
+        std::cout << setw(15) << incremental << ", " << setw(15) << keys.size() << ", " << setw(15) << sv_seconds << ", " << setw(15) << ha_seconds << "\n";
+        std::cout << std::flush;
+    }
+
+    std::cout << "\nPartition geometry timing (search + insert + remove per key, scaled_geometry<Scale>):\n";
+    std::cout << setw(15) << "Data-Size" << ", " << setw(15) << "Scale=1" << ", " << setw(15) << "Scale=4" << ", " << setw(15) << "Scale=16"
+              << ", " << setw(15) << "Scale=64" << ", " << setw(15) << "Best-Scale\n";
+    for(size_t incremental = 1 << 12; incremental <= (1 << 20); incremental *= 4){
+        std::vector<int> data(incremental);
+        for(auto& d : data){
+            d = rand() % (2 * incremental);
+        }
+        std::vector<int> keys(TSIZE / 10);
+        for(auto& k : keys){
+            k = rand() % (2 * incremental);
+        }
+        double seconds[] = {time_geometry<1>(data, keys), time_geometry<4>(data, keys), time_geometry<16>(data, keys), time_geometry<64>(data, keys)};
+        size_t scales[]  = {1, 4, 16, 64};
+        auto   best      = std::min_element(seconds, seconds + 4) - seconds;
+
+        std::cout << setw(15) << incremental << ", " << setw(15) << seconds[0] << ", " << setw(15) << seconds[1] << ", " << setw(15) << seconds[2]
+                  << ", " << setw(15) << seconds[3] << ", " << setw(15) << scales[best] << "\n";
+        std::cout << std::flush;
+    }
+
+    std::cout << "\nWorst-case single insert latency (ascending values, contiguous VS segmented storage):\n";
+    std::cout << setw(15) << "Data-Size" << ", " << setw(15) << "Contiguous" << ", " << setw(15) << "Segmented\n";
+    for(size_t incremental = 1 << 16; incremental <= (1 << 24); incremental *= 4){
+        double                   worst_contiguous = 0, worst_segmented = 0;
+        HeapArray<int>           h;
+        SegmentedHeapArray<int>  g;
+        for(size_t i = 0; i < incremental; ++i){
+            begin = std::chrono::high_resolution_clock::now();
+            h.insert(static_cast<int>(i));                          // ascending values land in the final partition, so
+            end   = std::chrono::high_resolution_clock::now();      // the worst case is the growth step
+            ha_duration      = end-begin;
+            worst_contiguous = std::max(worst_contiguous, ha_duration.count());
+
+            begin = std::chrono::high_resolution_clock::now();
+            g.insert(static_cast<int>(i));
+            end   = std::chrono::high_resolution_clock::now();
+            ha_duration     = end-begin;
+            worst_segmented = std::max(worst_segmented, ha_duration.count());
+        }
+
+        std::cout << setw(15) << incremental << ", " << setw(15) << worst_contiguous << ", " << setw(15) << worst_segmented << "\n";
+        std::cout << std::flush;
+    }
+
     return 0;
 }
@@ -1,20 +1,59 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
 #include <algorithm>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <set>
 #include "../heaparray.h"
+#include "../heaparray_map.h"
+#include "../hugepage_allocator.h"
+#include "../concurrent_heaparray.h"
+#include "../snapshot_heaparray.h"
+#include "../sharded_heaparray.h"
+#include "../static_heaparray.h"
 
 template <typename DType>
 void print_array(DType* a, int size);
 template <typename DType>
 void print_heaparray(const HeapArray<DType>& ha);
-template <typename DType>
-void print_levels(const HeapArray<DType>& ha);
+template <typename DType, typename... Order>
+void print_levels(const HeapArray<DType, Order...>& ha);
 std::string randstr(size_t length=3);
 
+/*
+ * a value whose copy constructor throws once `copies_left` runs out, counting the
+ * instances alive (to check that nothing leaks when a copy throws)
+ */
+struct throwing_copy{
+    static int live;
+    static int copies_left;
+    int        value;
+
+    throwing_copy(int v = 0) : value(v){ ++live; }
+    throwing_copy(const throwing_copy& rhs) : value(rhs.value){
+        if(copies_left-- == 0){
+            throw std::runtime_error("copy failed");
+        }
+        ++live;
+    }
+    throwing_copy(throwing_copy&& rhs) noexcept : value(rhs.value){ ++live; }
+    throwing_copy& operator=(const throwing_copy&) = default;
+    throwing_copy& operator=(throwing_copy&&) = default;
+    ~throwing_copy(){ --live; }
+    bool operator<(const throwing_copy& rhs)const{ return value < rhs.value; }
+    bool operator==(const throwing_copy& rhs)const{ return value == rhs.value; }
+};
+int throwing_copy::live        = 0;
+int throwing_copy::copies_left = -1;
+
 int main() {
     //srand(time(0));
     srand(8283);
@@ -154,8 +193,971 @@ int main() {
             std::cout << "OK\n";
         }
 
+        std::cout << "Move and emplace...\n";
+
+        HeapArray<std::string> ha3;
+        for(auto v : test_values){
+            ha3.insert(std::move(v));
+        }
+        ha3.emplace(3, 'z');
+        ha3.emplace("");
+        ok = ha3.size() == static_cast<size_t>(vsize + 2) && ha3.min() == "" && ha3.contains("zzz");
+        for(int i = 0; ok && i < vsize; ++i){
+            if(!ha3.contains(test_values[i])){
+                std::cout << "Failed to find " << test_values[i] << "\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Copy and capacity...\n";
+
+        ha3.reserve(1000);
+        HeapArray<std::string> ha3_copy(ha3), ha3_assigned;
+        ha3_assigned = ha3;
+        ha3_assigned = ha3;                                                                         // (reuses its storage)
+        auto ha3_fit = ha3.clone(true);
+        ok = ha3.capacity() >= 1000 && ha3_copy.capacity() == ha3.capacity() && ha3_assigned.capacity() == ha3.capacity()
+             && ha3_fit.capacity() < static_cast<size_t>(vsize + 20) && ha3_fit.size() == ha3.size();
+        for(size_t i = 0; ok && i < ha3.size(); ++i){
+            if(ha3_copy[i] != ha3[i] || ha3_assigned[i] != ha3[i] || ha3_fit[i] != ha3[i]){         // (the same layout, too)
+                std::cout << "Failed.  A copy differs at " << i << "\n";
+                ok = false;
+            }
+        }
+        ha3.shrink_to_fit();
+        if(ok && (ha3.capacity() != ha3_fit.capacity() || !ha3.contains("zzz"))){
+            std::cout << "Failed.  Wrong capacity after shrink_to_fit.\n";
+            ok = false;
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
         print_heaparray(ha);
     }
+    {
+        const int vsize = 35;
+        int       test_values[vsize];
+        for(int i = 0; i < vsize; ++i){
+            test_values[i] = rand() % 100;
+        }
+
+        std::cout << "Bulk insert...\n";
+
+        HeapArray<int> ha;
+        for(int i = 0; i < vsize / 2; ++i){
+            ha.insert(test_values[i]);
+        }
+        ha.insert_bulk(test_values + vsize / 2, test_values + vsize);
+        print_levels(ha);
+
+        bool ok = ha.size() == static_cast<size_t>(vsize);
+        for(auto v : test_values){
+            if(!ha.contains(v)){
+                std::cout << "Failed to find " << v << "\n";
+                ok = false;
+                break;
+            }
+        }
+        if(ha.min() != *std::min_element(test_values, test_values+vsize)
+            || ha.max() != *std::max_element(test_values, test_values+vsize)){
+            std::cout << "Failed.  Wrong min/max after bulk insert.\n";
+            ok = false;
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Bulk remove...\n";
+
+        auto removed = ha.remove_bulk(test_values, test_values + vsize / 2);
+        removed     += ha.erase_if([](int v){ return v % 2 == 0; });
+        print_levels(ha);
+
+        ok = removed + ha.size() == static_cast<size_t>(vsize);
+        for(int i = vsize / 2; ok && i < vsize; ++i){
+            if(ha.contains(test_values[i]) != (test_values[i] % 2 != 0)){
+                std::cout << "Failed.  Wrong membership for " << test_values[i] << "\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Lazy remove...\n";
+
+        HeapArray<int> ha2(test_values, test_values+vsize);
+        ha2.set_lazy_remove(true, 0.5);
+        for(int i = 0; ok && i < vsize; i += 2){
+            if(!ha2.remove(test_values[i])){
+                std::cout << "Failed (didn't find value " << test_values[i] << ").\n";
+                ok = false;
+            }
+        }
+        std::vector<int> expected(test_values, test_values+vsize);
+        for(int i = 0; i < vsize; i += 2){
+            expected.erase(std::find(expected.begin(), expected.end(), test_values[i]));
+        }
+        if(ok && (ha2.size() != expected.size()
+            || ha2.min() != *std::min_element(expected.begin(), expected.end())
+            || ha2.max() != *std::max_element(expected.begin(), expected.end()))){
+            std::cout << "Failed.  Wrong size or min/max after lazy remove.\n";
+            ok = false;
+        }
+        ha2.compact();
+        print_levels(ha2);
+        for(auto v : expected){
+            if(ok && !ha2.contains(v)){
+                std::cout << "Failed to find " << v << "\n";
+                ok = false;
+            }
+        }
+        const int      lazy_n = 1 << 18;                                                            // large enough that compacting on each
+        HeapArray<int> hl;                                                                          // insert would take minutes
+        std::vector<int> lazy_values(lazy_n);
+        for(int i = 0; i < lazy_n; ++i){
+            lazy_values[i] = static_cast<int>(i * 2654435761u % lazy_n) * 2;                        // (the evens, in no order)
+        }
+        hl.insert_bulk(lazy_values.begin(), lazy_values.end());
+        hl.set_lazy_remove(true);
+        std::multiset<int> lazy_expected(lazy_values.begin(), lazy_values.end());
+        for(int i = 0; i < 20000; ++i){                                                             // interleave the removes and inserts
+            hl.remove(lazy_values[i]);
+            lazy_expected.erase(lazy_expected.find(lazy_values[i]));
+            int v = static_cast<int>(i * 40503u % lazy_n) * 2 + 1 - (i % 7 == 0 ? 1 : 0);           // (odd, or a duplicate even)
+            hl.insert(v);
+            lazy_expected.insert(v);
+        }
+        ok = ok && hl.size() == lazy_expected.size() && hl.min() == *lazy_expected.begin() && hl.max() == *lazy_expected.rbegin();
+        for(int v = 0; ok && v < lazy_n * 2; v += 3){
+            if(hl.contains(v) != (lazy_expected.count(v) > 0)){
+                std::cout << "Failed.  Wrong membership for " << v << " after lazy inserts.\n";
+                ok = false;
+            }
+        }
+        auto lazy_next = lazy_expected.begin();
+        for(auto it = hl.ordered_begin(); ok && it != hl.ordered_end(); ++it, ++lazy_next){         // (dead slots reused in place keep
+            if(*it != *lazy_next){                                                                  //  the partitions in order)
+                std::cout << "Failed.  Out of order after lazy inserts.\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Vectorized search...\n";
+
+        const size_t         scan_n = 37;                                                           // several vectors of any width, then
+        std::vector<double>  scan_d(scan_n);                                                        // a scalar tail
+        std::vector<int64_t> scan_l(scan_n);
+        for(size_t pos = 0; ok && pos < scan_n; ++pos){                                             // put the match at every offset, in
+            for(size_t i = 0; i < scan_n; ++i){                                                     // the vector blocks and in the tail
+                scan_d[i] = i < pos ? -1.5 - i : 1.5 + i;
+                scan_l[i] = static_cast<int64_t>(i + 1) << 33 | 7;                                  // (low halves all equal the needle's)
+            }
+            scan_d[pos] = 0.0;
+            scan_l[pos] = 7;
+            size_t zero_at = _heaparray::find_equal(scan_d.data(), scan_n, -0.0);                   // -0.0 == 0.0
+            size_t long_at = _heaparray::find_equal(scan_l.data(), scan_n, int64_t{7});
+            scan_d[pos]    = std::nan("");
+            size_t nan_at  = _heaparray::find_equal(scan_d.data(), scan_n, std::nan(""));           // NaN never matches
+            if(zero_at != pos || long_at != pos || nan_at != scan_n
+                || _heaparray::find_equal(scan_l.data(), scan_n, static_cast<int64_t>(scan_n + 1) << 33 | 7) != scan_n){
+                std::cout << "Failed.  Wrong offset for a match at " << pos << "\n";
+                ok = false;
+            }
+        }
+        HeapArray<double>  hsd;
+        HeapArray<int64_t> hsl;
+        for(int i = 0; i < vsize * 10; ++i){                                                        // (partitions wider than one vector)
+            hsd.insert(i * 3 % (vsize * 10) - vsize * 5.0);
+            hsl.insert(static_cast<int64_t>(i * 3 % (vsize * 10)) << 33);
+        }
+        for(int i = 0; ok && i < vsize * 10; ++i){
+            if(!hsd.contains(i - vsize * 5.0) || hsd.contains(i - vsize * 5.0 + 0.5)
+                || !hsl.contains(static_cast<int64_t>(i) << 33) || hsl.contains(static_cast<int64_t>(i) << 33 | 1)){
+                std::cout << "Failed.  Wrong membership for " << i << "\n";
+                ok = false;
+            }
+        }
+        if(ok && !hsd.contains(-0.0)){
+            std::cout << "Failed to find -0.0\n";
+            ok = false;
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Integer square root...\n";
+
+        const size_t root_max = (size_t{1} << (sizeof(size_t) * 4)) - 1;                            // (2^32 - 1 with a 64-bit size_t)
+        std::vector<size_t> roots = {1, 2, 3, 255, 256, 4095, 65535, 65536, root_max / 2, root_max - 1, root_max};
+        if(sizeof(size_t) == 8){
+            roots.push_back(94906265);                                                              // (about sqrt(2^53), where doubles
+            roots.push_back(94906266);                                                              //  stop being exact)
+        }
+        ok = _heaparray::isqrt(0) == 0 && _heaparray::isqrt(SIZE_MAX) == root_max;
+        for(auto r : roots){                                                                        // exact at r^2 and either side of it
+            if(ok && (_heaparray::isqrt(r * r) != r || _heaparray::isqrt(r * r - 1) != r - 1 || _heaparray::isqrt(r * r + 1) != r
+                      || _heaparray::isqrt(r * r + 2 * r) != r)){
+                std::cout << "Failed.  Wrong integer square root near " << r << "^2\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Max-first order...\n";
+
+        MaxHeapArray<int> ha3(test_values, test_values+vsize);
+        ha3.insert(-1);
+        ha3.insert(100);
+        print_levels(ha3);
+
+        ok = ha3.size() == static_cast<size_t>(vsize + 2) && ha3.min() == 100 && ha3.max() == -1;
+        for(auto v : test_values){
+            if(ok && !ha3.contains(v)){
+                std::cout << "Failed to find " << v << "\n";
+                ok = false;
+            }
+        }
+        if(ok && (!ha3.remove(100) || ha3.min() != *std::max_element(test_values, test_values+vsize))){
+            std::cout << "Failed.  Wrong min after remove.\n";
+            ok = false;
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Arena allocation...\n";
+
+#if defined(__cpp_lib_memory_resource)
+        {
+            char                                arena_buffer[4096];
+            std::pmr::monotonic_buffer_resource arena(arena_buffer, sizeof arena_buffer, std::pmr::null_memory_resource());
+            PmrHeapArray<int>                   hp(&arena);
+            for(auto v : test_values){
+                hp.insert(v);
+            }
+            ok = hp.size() == static_cast<size_t>(vsize)
+                && hp.min() == *std::min_element(test_values, test_values+vsize)
+                && hp.max() == *std::max_element(test_values, test_values+vsize);
+            for(int i = 0; ok && i < vsize; i += 2){
+                if(!hp.remove(test_values[i])){
+                    std::cout << "Failed (didn't find value " << test_values[i] << ").\n";
+                    ok = false;
+                }
+            }
+            if(ok){
+                std::cout << "OK\n";
+            }
+            else{
+                std::cout << "Failed.\n";
+            }
+        }
+#endif
+
+        std::cout << "Throwing copies...\n";
+
+        {
+            std::vector<throwing_copy> sources(vsize * 3);
+            for(int i = 0; i < vsize * 3; ++i){
+                sources[i].value = i * 7 % (vsize * 3);
+            }
+            int before = throwing_copy::live;
+            throwing_copy::copies_left = vsize;                                                     // (fails partway through the range)
+            try{
+                HeapArray<throwing_copy> ht(sources.data(), sources.data() + sources.size());
+                ok = false;
+            }
+            catch(std::runtime_error&){}
+            HeapArray<throwing_copy> ht;
+            ht.insert_bulk(sources.begin(), sources.begin() + vsize);
+            throwing_copy::copies_left = vsize;
+            try{
+                ht.insert_bulk(sources.begin() + vsize, sources.end());
+                ok = false;
+            }
+            catch(std::runtime_error&){}
+            throwing_copy::copies_left = -1;
+            ok = ok && throwing_copy::live == before + vsize && ht.size() == static_cast<size_t>(vsize);
+            for(int i = 0; ok && i < vsize; ++i){
+                if(!ht.contains(sources[i])){
+                    std::cout << "Failed to find " << sources[i].value << "\n";
+                    ok = false;
+                }
+            }
+        }
+        if(ok && throwing_copy::live == 0){
+            std::cout << "OK\n";
+        }
+        else{
+            std::cout << "Failed.  Values leaked when a copy threw.\n";
+        }
+
+        std::cout << "Segmented storage...\n";
+
+        SegmentedHeapArray<int> hseg;
+        std::multiset<int>      hseg_expected;
+        for(int i = 0; i < vsize * 100; ++i){                                                       // grow through many segments
+            int v = i * 37 % (vsize * 100);
+            hseg.insert(v);
+            hseg_expected.insert(v);
+        }
+        for(int i = 0; i < vsize * 100; i += 3){                                                    // remove some values, rippling...
+            hseg.remove(i);
+            hseg_expected.erase(hseg_expected.find(i));
+        }
+        hseg.set_lazy_remove(true);
+        for(int i = 1; i < vsize * 100; i += 5){                                                    // ...and some lazily
+            if(hseg_expected.count(i) > 0){
+                hseg.remove(i);
+                hseg_expected.erase(hseg_expected.find(i));
+            }
+        }
+        hseg.insert_bulk(test_values, test_values + vsize);
+        hseg_expected.insert(test_values, test_values + vsize);
+        hseg.insert(vsize * 200);
+        hseg_expected.insert(vsize * 200);
+        print_levels(hseg);
+        ok = hseg.size() == hseg_expected.size() && hseg.min() == *hseg_expected.begin() && hseg.max() == *hseg_expected.rbegin();
+        for(int v = 0; ok && v <= vsize * 200; ++v){
+            if(hseg.contains(v) != (hseg_expected.count(v) > 0)){
+                std::cout << "Failed.  Wrong membership for " << v << " in segmented storage.\n";
+                ok = false;
+            }
+        }
+        SegmentedHeapArray<int> hseg_copy(hseg), hseg_assigned;
+        hseg_assigned = hseg;
+        hseg.compact();
+        auto hseg_capacity = hseg.capacity();
+        hseg.shrink_to_fit();
+        ok = ok && hseg_copy.size() == hseg_expected.size() && hseg_assigned.size() == hseg_expected.size()
+             && hseg.capacity() < hseg_capacity && hseg.capacity() >= hseg.size();
+        auto hseg_next = hseg_expected.begin();
+        for(auto it = hseg.ordered_begin(); ok && it != hseg.ordered_end(); ++it, ++hseg_next){
+            if(*it != *hseg_next || !hseg_copy.contains(*it) || !hseg_assigned.contains(*it)){
+                std::cout << "Failed.  Wrong values after copying and shrinking segmented storage.\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Huge page allocation...\n";
+
+        HugePageHeapArray<int> hh(1 << 20, true, hugepage_allocator<int>(hugepage_mode::explicit_2mb));
+        hh.insert_bulk(test_values, test_values + vsize);
+        ok = hh.size() == static_cast<size_t>(vsize) && hh.min() == *std::min_element(test_values, test_values+vsize);
+        for(int i = 0; ok && i < vsize; ++i){
+            if(!hh.contains(test_values[i])){
+                std::cout << "Failed to find " << test_values[i] << "\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+#if defined(__cpp_lib_execution)
+        std::cout << "Parallel build...\n";
+
+        std::vector<int> many(1 << 18);
+        for(size_t i = 0; i < many.size(); ++i){
+            many[i] = static_cast<int>(i * 2654435761u % many.size());                              // (a permutation)
+        }
+        HeapArray<int> hp(std::execution::par, many.data(), many.data() + many.size() / 2);
+        hp.insert_bulk(std::execution::par, many.begin() + many.size() / 2, many.end());
+        ok = hp.size() == many.size() && hp.min() == 0 && hp.max() == static_cast<int>(many.size()) - 1;
+        for(size_t i = 0; ok && i < many.size(); i += 97){
+            if(!hp.contains(many[i])){
+                std::cout << "Failed to find " << many[i] << "\n";
+                ok = false;
+            }
+        }
+        if(ok && hp.erase_if(std::execution::par, [](int x){ return x % 2 == 1; }) != many.size() / 2){
+            std::cout << "Failed.  Wrong number of values erased.\n";
+            ok = false;
+        }
+        std::vector<int> fours;
+        for(size_t i = 0; i < many.size(); i += 4){
+            fours.push_back(static_cast<int>(i));
+        }
+        if(ok && hp.remove_bulk(std::execution::par, fours.begin(), fours.end()) != fours.size()){
+            std::cout << "Failed.  Wrong number of values removed.\n";
+            ok = false;
+        }
+        for(size_t i = 0; ok && i < many.size(); i += 2){
+            if(hp.contains(static_cast<int>(i)) != (i % 4 == 2)){                                   // (only the 4k + 2 remain)
+                std::cout << "Failed.  Wrong values after the parallel remove.\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+#endif
+
+        std::cout << "Serialization...\n";
+
+        HeapArray<int> hs;
+        hs.insert_bulk(test_values, test_values + vsize);
+        std::stringstream snapshot;
+        hs.serialize(snapshot);
+        HeapArray<int> hs2;
+        hs2.deserialize(snapshot);
+        std::vector<char> snapshot_buffer;
+        hs.serialize(snapshot_buffer, false);
+        SegmentedHeapArray<int> hs3;
+        ok = hs3.deserialize(snapshot_buffer.data(), snapshot_buffer.size()) == snapshot_buffer.size();
+        ok = ok && hs2.size() == hs.size() && hs3.size() == hs.size();
+        for(size_t i = 0; ok && i < hs.size(); ++i){                                                // the layout comes back exactly as it was
+            if(hs2[i] != hs[i] || hs3[i] != hs[i]){
+                std::cout << "Failed.  Wrong value at index " << i << " after reloading.\n";
+                ok = false;
+            }
+        }
+        std::string corrupt = snapshot.str();
+        corrupt[corrupt.size() - 1] ^= 1;
+        try{
+            hs2.deserialize(corrupt.data(), corrupt.size());
+            std::cout << "Failed.  A corrupt snapshot was accepted.\n";
+            ok = false;
+        }
+        catch(std::runtime_error&){
+            ok = ok && hs2.size() == 0;
+        }
+        std::string inflated = snapshot.str().substr(0, 72);                                        // (the header and two values...)
+        uint64_t    claimed  = uint64_t{1} << 38;
+        std::memcpy(&inflated[16], &claimed, sizeof(claimed));                                      // (...claiming 2^38 of them)
+        std::stringstream inflated_stream(inflated);
+        for(int attempt = 0; ok && attempt < 2; ++attempt){
+            try{
+                if(attempt == 0){
+                    hs3.deserialize(inflated.data(), inflated.size());
+                }
+                else{
+                    hs3.deserialize(inflated_stream);
+                }
+                std::cout << "Failed.  An inflated snapshot count was accepted.\n";
+                ok = false;
+            }
+            catch(std::runtime_error&){
+                ok = hs3.size() == hs.size();                                                       // (rejected before anything is released)
+            }
+        }
+        hs.set_lazy_remove(true, 0.9);
+        hs.remove(test_values[0]);
+        hs.remove(test_values[1]);
+        const HeapArray<int>& hs_view = hs;                                                         // a const HeapArray with dead slots
+        std::stringstream     live_snapshot;
+        hs_view.serialize(live_snapshot);
+        hs2.deserialize(live_snapshot);
+        ok = ok && hs2.size() == hs.size() && hs2.min() == hs.min() && hs2.max() == hs.max();
+        for(int i = 0; ok && i < vsize; ++i){                                                       // (the dead slots are still there, and
+            if(hs[i] != hs3[i] || hs2.contains(test_values[i]) != hs.contains(test_values[i])){     //  nothing moved)
+                std::cout << "Failed.  Serializing changed the HeapArray or lost " << test_values[i] << "\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Memory-mapped image...\n";
+
+        const char* image_path = "test_heaparray.img";
+        HeapArray<int> img;
+        img.insert_bulk(test_values, test_values + vsize);
+        img.save(image_path);
+        {
+            auto hmap = HeapArray<int>::open_mapped(image_path);
+            ok = hmap.mapped() && hmap.size() == img.size() && hmap.min() == img.min() && hmap.max() == img.max();
+            for(int i = 0; ok && i < vsize; ++i){
+                if(!hmap.contains(test_values[i])){
+                    std::cout << "Failed to find " << test_values[i] << " in the mapped image\n";
+                    ok = false;
+                }
+            }
+            for(int i = 0; i < vsize; ++i){                                                         // grow the file, then checkpoint it
+                hmap.insert(-1 - i);
+            }
+            hmap.remove(-1);
+            hmap.sync();
+        }
+        auto reopened = HeapArray<int>::open_mapped(image_path);
+        if(ok && (reopened.size() != 2 * img.size() - 1 || reopened.min() != -vsize || reopened.contains(-1)
+                  || !reopened.contains(test_values[0]))){
+            std::cout << "Failed.  Wrong contents after reopening the image.\n";
+            ok = false;
+        }
+        reopened = HeapArray<int>();
+        std::remove(image_path);
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Priority queue...\n";
+
+        HeapArray<int> hq;
+        std::multiset<int> hq_ref;
+        for(int i = 0; i < vsize * 10; ++i){
+            hq.insert(i * 37 % (vsize * 5));                                                        // (with duplicates)
+            hq_ref.insert(i * 37 % (vsize * 5));
+        }
+        std::vector<int> smallest, largest;
+        hq.top_k_smallest(vsize, std::back_inserter(smallest));
+        hq.top_k_largest(vsize, std::back_inserter(largest));
+        ok = std::equal(smallest.begin(), smallest.end(), hq_ref.begin()) && smallest.size() == static_cast<size_t>(vsize)
+             && std::equal(largest.begin(), largest.end(), hq_ref.rbegin()) && largest.size() == static_cast<size_t>(vsize);
+        if(!ok){
+            std::cout << "Failed.  Wrong top-k results.\n";
+        }
+        for(int i = 0; ok && i < vsize * 8; ++i){
+            int popped = i % 3 ? hq.pop_min() : hq.pop_max();
+            int wanted = i % 3 ? *hq_ref.begin() : *hq_ref.rbegin();
+            hq_ref.erase(i % 3 ? hq_ref.begin() : std::prev(hq_ref.end()));
+            if(i % 5 == 0){
+                hq.insert(wanted + 1);                                                              // (back into the partition being drained)
+                hq_ref.insert(wanted + 1);
+            }
+            if(popped != wanted || hq.size() != hq_ref.size() || hq.min() != *hq_ref.begin() || hq.max() != *hq_ref.rbegin()){
+                std::cout << "Failed.  Wrong value popped: " << popped << " (expected " << wanted << ")\n";
+                ok = false;
+            }
+        }
+        for(int v = 0; ok && v < vsize * 5; ++v){
+            if(hq.contains(v) != (hq_ref.count(v) > 0)){
+                std::cout << "Failed.  Wrong membership for " << v << " after popping\n";
+                ok = false;
+            }
+        }
+        while(ok && hq.size() > 0){
+            hq.pop_min();
+        }
+        try{
+            hq.pop_min();
+            if(ok){
+                std::cout << "Failed.  Popping an empty HeapArray didn't throw.\n";
+            }
+            ok = false;
+        }
+        catch(const std::out_of_range&){}
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Batched lookups...\n";
+
+        std::vector<int> batch_keys;
+        for(int i = -5; i < vsize * 40; ++i){
+            batch_keys.push_back(i % 2 ? i : vsize * 40 - i);                                       // (present and absent, in no order)
+        }
+        HeapArray<int> hb;
+        for(int i = 0; i < vsize * 30; ++i){
+            hb.insert(i % (vsize * 20));                                                            // (with duplicates)
+        }
+        hb.set_lazy_remove(true);
+        for(int i = 0; i < vsize * 20; i += 7){
+            hb.remove(i);                                                                           // leave some dead slots
+        }
+        ok = true;
+        for(int pass = 0; ok && pass < 2; ++pass){
+            std::vector<std::pair<bool, size_t>> found(batch_keys.size());
+            std::unique_ptr<bool[]> present(new bool[batch_keys.size()]);
+            hb.find_many(batch_keys.data(), batch_keys.size(), found.data());
+            hb.contains_many(batch_keys.data(), batch_keys.size(), present.get());
+            for(size_t i = 0; ok && i < batch_keys.size(); ++i){
+                if(found[i] != hb.find(batch_keys[i]) || present[i] != hb.contains(batch_keys[i])){
+                    std::cout << "Failed.  Wrong batched result for " << batch_keys[i] << "\n";
+                    ok = false;
+                }
+            }
+            hb.set_bounds_cache(false);                                                             // again, probing the heap roots
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Range queries...\n";
+
+        HeapArray<int> hr;
+        for(int i = 0; i < vsize; ++i){
+            hr.insert(i * 8 % vsize);                                                               // 0 .. vsize-1, each once
+        }
+        for(int i = 0; i < vsize; i += 3){
+            hr.remove(i);                                                                           // (leaves some slots dead)
+        }
+        std::set<int> hr_ref;
+        for(int i = 0; i < vsize; ++i){
+            if(i % 3 != 0){
+                hr_ref.insert(i);
+            }
+        }
+        ok = std::equal(hr.ordered_begin(), hr.ordered_end(), hr_ref.begin(), hr_ref.end());
+        if(!ok){
+            std::cout << "Failed.  Ordered iteration is not ascending.\n";
+        }
+        for(int lo = -5; ok && lo < vsize + 5; lo += vsize / 7 + 1){
+            int    hi       = lo + vsize / 5;
+            size_t expected = std::distance(hr_ref.lower_bound(lo), hr_ref.upper_bound(hi));
+            size_t visited  = 0;
+            hr.for_each_in_range(lo, hi, [&](const int& v){ visited += v >= lo && v <= hi ? 1 : 0; });
+            auto   it       = hr.ordered_lower_bound(lo);
+            if(hr.count_range(lo, hi) != expected || visited != expected
+               || (it == hr.ordered_end()) != (hr_ref.lower_bound(lo) == hr_ref.end())
+               || (it != hr.ordered_end() && *it != *hr_ref.lower_bound(lo))){
+                std::cout << "Failed.  Wrong range result for [" << lo << ", " << hi << "]\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Order statistics...\n";
+
+        std::vector<int> hr_sorted(hr_ref.begin(), hr_ref.end());
+        hr.pop_min();                                                                               // (drains from the front, too)
+        hr_sorted.erase(hr_sorted.begin());
+        ok = hr.median() == hr_sorted[(hr_sorted.size() - 1) / 2] && hr.rank(hr_sorted.front()) == 0
+             && hr.rank(vsize) == hr_sorted.size();
+        for(size_t k = 0; ok && k < hr_sorted.size(); ++k){
+            auto bounds = hr.approx_quantile(static_cast<double>(k) / (hr_sorted.size() - 1));
+            if(hr.select(k) != hr_sorted[k] || hr.rank(hr_sorted[k]) != k
+               || bounds.first > hr_sorted[k] || bounds.second < hr_sorted[k]){
+                std::cout << "Failed.  Wrong order statistic for rank " << k << "\n";
+                ok = false;
+            }
+        }
+        try{
+            hr.select(hr.size());
+            if(ok){
+                std::cout << "Failed.  Selecting past the end didn't throw.\n";
+            }
+            ok = false;
+        }
+        catch(const std::out_of_range&){}
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Merge and split...\n";
+
+        HeapArray<int> hs_low, hs_high;
+        for(int i = 0; i < vsize; ++i){
+            hs_low.insert(i * 8 % vsize * 2);                                                       // evens and odds, interleaved
+            hs_high.insert(i * 8 % vsize * 2 + 1);
+        }
+        hs_high.remove(1);
+        hs_low.merge(std::move(hs_high));
+        ok = hs_high.size() == 0 && hs_low.size() == static_cast<size_t>(vsize * 2 - 1);
+        for(int i = 0; ok && i < vsize * 2; ++i){
+            if(hs_low.contains(i) != (i != 1) || (i != 1 && hs_low.select(i - (i > 1 ? 1 : 0)) != i)){
+                std::cout << "Failed.  Wrong values after a merge, at " << i << "\n";
+                ok = false;
+            }
+        }
+        auto hs_top  = hs_low.split_at(vsize);
+        auto hs_tail = hs_top.split_at_rank(10);
+        if(ok && (hs_low.size() != static_cast<size_t>(vsize - 1) || hs_low.max() != vsize - 1 || hs_top.size() != 10
+                  || hs_top.min() != vsize || hs_top.max() != vsize + 9 || hs_tail.min() != vsize + 10
+                  || hs_tail.size() != static_cast<size_t>(vsize - 10))){
+            std::cout << "Failed.  Wrong values after a split.\n";
+            ok = false;
+        }
+        hs_top.merge(std::move(hs_tail));
+        hs_top.insert(vsize * 3);
+        if(ok && (!std::is_sorted(hs_top.ordered_begin(), hs_top.ordered_end()) || hs_top.size() != static_cast<size_t>(vsize + 1))){
+            std::cout << "Failed.  Wrong values after merging a split back.\n";
+            ok = false;
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Membership filter...\n";
+
+        HeapArray<int> hm_filtered;
+        hm_filtered.set_membership_filter(true);
+        for(int i = 0; i < vsize * 100; ++i){                                                       // (past the filter's first size, so it
+            hm_filtered.insert(i * 3 % (vsize * 100) * 2);                                          // is rebuilt along the way)
+        }
+        std::vector<int> evens(vsize * 50);
+        for(size_t i = 0; i < evens.size(); ++i){
+            evens[i] = static_cast<int>(i) * 4;
+        }
+        hm_filtered.remove_bulk(evens.begin(), evens.end());
+        hm_filtered.pop_min();
+        hm_filtered.pop_max();
+        ok = hm_filtered.membership_filter() && hm_filtered.size() == static_cast<size_t>(vsize * 50 - 2) && !hm_filtered.remove(3);
+        if(!ok){
+            std::cout << "Failed.  Wrong size after removals with the filter enabled.\n";
+        }
+        std::vector<int> probes(vsize * 200);
+        for(size_t i = 0; i < probes.size(); ++i){
+            probes[i] = static_cast<int>(i);
+        }
+        std::unique_ptr<bool[]> present(new bool[probes.size()]);
+        hm_filtered.contains_many(probes.data(), probes.size(), present.get());
+        for(int i = 0; ok && i < vsize * 200; ++i){
+            bool expected = i % 4 == 2 && i != 2 && i != vsize * 200 - 2;
+            if(hm_filtered.contains(i) != expected || present[i] != expected){
+                std::cout << "Failed.  Wrong membership for " << i << " with the filter enabled.\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Performance counters...\n";
+
+        HeapArray<int, std::less<int>, std::equal_to<int>, std::allocator<int>, contiguous_storage, square_geometry, counting_stats> hcounted;
+        size_t hooked = 0;
+        hcounted.statistics().on_end = [&hooked](heaparray_op op){
+            hooked += op == heaparray_op::insert ? 1 : 0;
+        };
+        for(int i = 0; i < vsize; ++i){
+            hcounted.insert(vsize - i);                                                             // (descending: every insert ripples)
+        }
+        hcounted.contains(1);
+        hcounted.remove(vsize);
+        auto& counters = hcounted.statistics();
+        ok = hooked == static_cast<size_t>(vsize) && counters.operations[static_cast<size_t>(heaparray_op::insert)] == hooked
+             && counters.ripples.samples == hooked + 1 && counters.ripples.total > hooked && counters.scans.samples == 2
+             && counters.searches.samples > 0 && counters.resizes > 0;
+        std::ostringstream counters_out;
+        counters.write(counters_out);
+        if(ok && counters_out.str().find("heaparray_remove_total 1\n") == std::string::npos){
+            ok = false;
+        }
+        counters.reset();
+        if(!ok || counters.ripples.samples != 0 || !counters.on_end){
+            std::cout << "Failed.  Wrong performance counters.\n";
+            ok = false;
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Concurrent access...\n";
+
+        const int workers = 4;
+        ConcurrentHeapArray<int> hc(workers * 1000);
+        std::vector<std::thread> threads;
+        std::atomic<bool> lost{false};
+        for(int t = 0; t < workers; ++t){
+            threads.emplace_back([&hc, &lost, t](){
+                for(int i = t; i < workers * 1000; i += workers){                                   // each thread inserts its own values,
+                    hc.insert(i);                                                                   // checks them, and removes every other one
+                    lost = lost || !hc.contains(i);
+                }
+                for(int i = t; i < workers * 1000; i += 2 * workers){
+                    lost = lost || !hc.remove(i);
+                }
+            });
+        }
+        for(auto& thread : threads){
+            thread.join();
+        }
+        ok = !lost && hc.size() == static_cast<size_t>(workers * 1000 / 2) && hc.max() == workers * 1000 - 1;
+        for(int i = 0; ok && i < workers * 1000; ++i){
+            if(hc.contains(i) != (i % (2 * workers) >= workers)){
+                std::cout << "Failed.  Wrong membership for " << i << "\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+        else if(lost){
+            std::cout << "Failed.  A value went missing during concurrent access.\n";
+        }
+
+        std::cout << "Snapshot reads...\n";
+
+        SnapshotHeapArray<int> hv(8);
+        std::atomic<bool> torn{false};
+        std::atomic<bool> writing{true};
+        std::vector<std::thread> snapshot_readers;
+        for(int t = 0; t < workers; ++t){
+            snapshot_readers.emplace_back([&hv, &torn, &writing](){
+                auto r = hv.make_reader();
+                while(writing){                                                                     // values 0..n-1 are published in
+                    auto v = r.snapshot();                                                          // order, so every view must hold
+                    auto n = static_cast<int>(v.size());                                            // exactly those
+                    if(n > 0){
+                        torn = torn || v.min() != 0 || v.max() != n - 1 || !v.contains(n / 2) || v.contains(n);
+                    }
+                }
+            });
+        }
+        for(int i = 0; i < vsize * 10; i += 25){
+            std::vector<int> batch;
+            for(int j = i + 24; j >= i; --j){
+                batch.push_back(j);
+            }
+            hv.insert_bulk(batch.begin(), batch.end());
+        }
+        writing = false;
+        for(auto& thread : snapshot_readers){
+            thread.join();
+        }
+        auto hvr = hv.make_reader();
+        {
+            auto held = hvr.snapshot();
+            std::vector<int> evens;
+            for(int i = 0; i < vsize * 10; i += 2){
+                evens.push_back(i);
+            }
+            ok = !torn && hv.remove_bulk(evens.begin(), evens.end()) == evens.size() && hv.size() == evens.size()
+                 && held.size() == static_cast<size_t>(vsize * 10) && held.contains(0) && held.contains(vsize * 10 - 2);
+        }
+        ok = ok && hv.erase_if([](int x){ return x % 3 == 0; }) == static_cast<size_t>((vsize * 10 + 2) / 6) && !hv.remove(3);
+        for(int i = 0; ok && i < vsize * 10; ++i){
+            if(hvr.snapshot().contains(i) != (i % 2 == 1 && i % 3 != 0)){
+                std::cout << "Failed.  Wrong membership for " << i << "\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+        else if(torn){
+            std::cout << "Failed.  A reader saw a partially published version.\n";
+        }
+        else{
+            std::cout << "Failed.  Wrong results from remove_bulk or erase_if.\n";
+        }
+
+        std::cout << "Sharded access...\n";
+
+        ShardedHeapArray<int, 4> hd;
+        std::vector<std::thread> ingest;
+        for(int t = 0; t < workers; ++t){
+            ingest.emplace_back([&hd, t](){
+                for(int i = t; i < workers * 1000; i += workers){                                   // each thread inserts its own values
+                    hd.insert(i);                                                                   // and removes every other one
+                }
+                for(int i = t; i < workers * 1000; i += 2 * workers){
+                    hd.remove(i);
+                }
+            });
+        }
+        for(auto& thread : ingest){
+            thread.join();
+        }
+        ok = hd.size() == static_cast<size_t>(workers * 1000 / 2) && hd.min() == workers && hd.max() == workers * 1000 - 1;
+        int next_value = workers;
+        for(auto v : hd){                                                                           // (ascending, across all shards)
+            if(ok && v != next_value){
+                std::cout << "Failed.  Wrong merged order at " << v << "\n";
+                ok = false;
+            }
+            next_value += next_value % (2 * workers) == 2 * workers - 1 ? workers + 1 : 1;
+        }
+        if(ok && (next_value != workers * 1000 + workers || !hd.contains(workers) || hd.contains(0))){
+            std::cout << "Failed.  Wrong membership after sharded access.\n";
+            ok = false;
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Partition geometry...\n";
+
+        HeapArray<int, std::less<int>, std::equal_to<int>, std::allocator<int>, contiguous_storage, cache_line_geometry<int>> hg;
+        for(int i = 0; i < vsize * 10; ++i){
+            hg.insert(i * 3 % (vsize * 10));
+        }
+        for(int i = 0; i < vsize * 10; i += 2){
+            hg.remove(i);
+        }
+        ok = hg.size() == static_cast<size_t>(vsize * 5) && hg.min() == 1 && hg.max() == vsize * 10 - 1
+             && hg.pop_min() == 1 && hg.select(0) == 3 && hg.count_range(0, vsize * 10) == hg.size();
+        if(!ok){
+            std::cout << "Failed.  Wrong size or order statistics with cache-line partitions.\n";
+        }
+        for(int i = 0; ok && i < vsize * 10; ++i){
+            if(hg.contains(i) != (i % 2 == 1 && i > 1)){
+                std::cout << "Failed.  Wrong membership for " << i << " with cache-line partitions.\n";
+                ok = false;
+            }
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Static capacity...\n";
+
+        StaticHeapArray<int, vsize> hf;
+        ok = hf.empty() && hf.capacity() == static_cast<size_t>(vsize);
+        for(int i = 0; i < vsize; ++i){
+            ok = ok && hf.insert(i * 8 % vsize);
+        }
+        ok = ok && hf.full() && !hf.insert(vsize) && hf.min() == 0 && hf.max() == vsize - 1;
+        for(int i = 0; ok && i < vsize; i += 2){
+            ok = hf.remove(i) && !hf.contains(i) && hf.contains(i + 1 < vsize ? i + 1 : i - 1);
+        }
+        if(!ok){
+            std::cout << "Failed.  Wrong results from the fixed-capacity container.\n";
+        }
+        else if(hf.size() != static_cast<size_t>(vsize / 2) || hf.min() != 1 || hf.max() != vsize - 2 || hf.remove(0)){
+            std::cout << "Failed.  Wrong size or min/max after removals.\n";
+            ok = false;
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+
+        std::cout << "Key/value map...\n";
+
+        HeapArrayMap<int, std::string> hm;
+        for(int i = 0; i < vsize; ++i){
+            hm.insert(i * 8 % vsize, "value " + std::to_string(i * 8 % vsize));
+        }
+        ok = hm.size() == static_cast<size_t>(vsize) && hm.min().first == 0 && hm.max().second == "value " + std::to_string(vsize - 1);
+        if(!ok){
+            std::cout << "Failed.  Wrong size or min/max.\n";
+        }
+        for(int k = 0; ok && k < vsize; ++k){
+            auto v = hm.find(k);
+            if(!v || *v != "value " + std::to_string(k)){
+                std::cout << "Failed.  Wrong payload for key " << k << "\n";
+                ok = false;
+            }
+        }
+        for(int k = 0; ok && k < vsize; k += 3){
+            if(!hm.remove(k) || hm.contains(k)){
+                std::cout << "Failed to remove key " << k << "\n";
+                ok = false;
+            }
+        }
+        hm.insert(vsize, "new value");
+        if(ok && (hm.at(vsize) != "new value" || hm.at(1) != "value 1")){
+            std::cout << "Failed.  Wrong payload after remove/insert.\n";
+            ok = false;
+        }
+        std::string* held = hm.find(1);
+        for(int k = vsize + 1; k < vsize * 100; ++k){                                               // (growing the payloads moves none of them)
+            hm.insert(k, "value " + std::to_string(k));
+        }
+        if(ok && (hm.find(1) != held || *held != "value 1")){
+            std::cout << "Failed.  A payload moved while the map grew.\n";
+            ok = false;
+        }
+        if(ok){
+            std::cout << "OK\n";
+        }
+    }
 
     return 0;
 }
@@ -174,8 +1176,8 @@ void print_heaparray(const HeapArray<DType>& ha){
     }
 }
 
-template <typename DType>
-void print_levels(const HeapArray<DType>& ha){
+template <typename DType, typename... Order>
+void print_levels(const HeapArray<DType, Order...>& ha){
     size_t p = 0;
     for(size_t i = 0; i < ha.size(); ++i){
         std::cout << std::setw(4) << ha[i] << (i+1 < ha.size() ? ", " : "\n");